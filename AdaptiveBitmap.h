@@ -0,0 +1,720 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Bitmask.h"
+#include "WordKernels.h"
+
+/*
+AdaptiveBitmap is a TMax wide bitmap that picks its representation from its current contents.
+
+-Array stores the set positions sorted, Dense stores one bit per position in words and Runs stores
+ sorted [start, length) intervals.
+-The choice follows a cost model with two thresholds, expressed as densities so they apply to any
+ TMax: an array is used while Count <= ArrayMaxDensity * TMax, runs while RunCount <=
+ RunsMaxDensity * TMax and runs are smaller than the array, and dense words otherwise.
+-AdaptiveThresholds::Current() calibrates the thresholds once per process with a micro-benchmark
+ that times membership probes plus a full iteration for each representation on this machine.
+-Single bit updates convert only when a threshold is crossed, with 2x hysteresis on the way back so
+ a bitmap sitting on a threshold does not flip on every update. Bulk operators always re-choose.
+*/
+
+
+// Cost model thresholds for AdaptiveBitmap, as fractions of the bitmap width.
+struct AdaptiveThresholds {
+    // Sorted array while cardinality <= ArrayMaxDensity * width.
+    double ArrayMaxDensity;
+    // Runs while run count <= RunsMaxDensity * width.
+    double RunsMaxDensity;
+
+    // Memory break-even points: an array entry costs 32 bits and a run 64 bits, a dense position 1 bit.
+    static AdaptiveThresholds Defaults()
+    {
+        return { 1.0 / 32, 1.0 / 64 };
+    }
+
+    // Time each representation on this machine and return the densities where dense words win.
+    static AdaptiveThresholds Calibrate()
+    {
+        constexpr uint32_t universe = 1 << 16;
+        constexpr int probes = 2048;
+
+        std::mt19937 random(12345);
+        std::vector<uint32_t> probePositions(probes);
+        for (uint32_t& pos : probePositions) {
+            pos = random() % universe;
+        }
+
+        AdaptiveThresholds result = Defaults();
+        bool arrayFound = false;
+        bool runsFound = false;
+        for (uint32_t count = universe / 1024; count <= universe / 4 && !(arrayFound && runsFound); count *= 2) {
+            // Evenly spread positions for the array test, runs of 4 bits for the runs test.
+            std::vector<uint32_t> positions;
+            std::vector<uint64_t> words(WordsFor(universe), 0);
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t pos = static_cast<uint32_t>(uint64_t(i) * universe / count);
+                positions.push_back(pos);
+                words[pos / WordBits] |= uint64_t(1) << (pos % WordBits);
+            }
+            std::vector<std::pair<uint32_t, uint32_t>> runs;
+            std::vector<uint64_t> runWords(WordsFor(universe), 0);
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t start = static_cast<uint32_t>(uint64_t(i) * (universe - 4) / count);
+                runs.emplace_back(start, 4);
+                runWords[start / WordBits] |= uint64_t(0xF) << (start % WordBits);
+                if (start % WordBits > WordBits - 4) {
+                    runWords[start / WordBits + 1] |= uint64_t(0xF) >> (WordBits - start % WordBits);
+                }
+            }
+
+            const double denseTime = TimeWorkload([&](uint32_t pos) { return (words[pos / WordBits] >> (pos % WordBits)) & 1; },
+                [&] { return PopCountWords(words.data(), words.size()); }, probePositions);
+            const double arrayTime = TimeWorkload([&](uint32_t pos) { return std::binary_search(positions.begin(), positions.end(), pos) ? 1u : 0u; },
+                [&] { size_t sum = 0; for (const uint32_t pos : positions) { sum += pos & 1; } return sum + positions.size(); }, probePositions);
+            const double runDenseTime = TimeWorkload([&](uint32_t pos) { return (runWords[pos / WordBits] >> (pos % WordBits)) & 1; },
+                [&] { return PopCountWords(runWords.data(), runWords.size()); }, probePositions);
+            const double runsTime = TimeWorkload([&](uint32_t pos) {
+                    auto it = std::upper_bound(runs.begin(), runs.end(), std::make_pair(pos, ~0u));
+                    return it != runs.begin() && pos < std::prev(it)->first + std::prev(it)->second ? 1u : 0u;
+                },
+                [&] { size_t sum = 0; for (const auto& run : runs) { sum += run.second; } return sum; }, probePositions);
+
+            if (!arrayFound && arrayTime > denseTime) {
+                result.ArrayMaxDensity = static_cast<double>(count / 2) / universe;
+                arrayFound = true;
+            }
+            if (!runsFound && runsTime > runDenseTime) {
+                result.RunsMaxDensity = static_cast<double>(count / 2) / universe;
+                runsFound = true;
+            }
+        }
+        // Keep the calibrated values within 4x of the memory break-even so noise cannot pick absurd layouts.
+        const AdaptiveThresholds defaults = Defaults();
+        result.ArrayMaxDensity = std::clamp(result.ArrayMaxDensity, defaults.ArrayMaxDensity / 4, defaults.ArrayMaxDensity * 4);
+        result.RunsMaxDensity = std::clamp(result.RunsMaxDensity, defaults.RunsMaxDensity / 4, defaults.RunsMaxDensity * 4);
+        return result;
+    }
+
+    // Thresholds used by every AdaptiveBitmap; calibrated on first use.
+    static const AdaptiveThresholds& Current()
+    {
+        static const AdaptiveThresholds calibrated = Calibrate();
+        return calibrated;
+    }
+
+private:
+    // Best of a few repetitions of: every probe, then one full scan. Returns seconds.
+    template <typename Probe, typename Scan>
+    static double TimeWorkload(Probe&& probe, Scan&& scan, const std::vector<uint32_t>& probePositions)
+    {
+        double best = 1e30;
+        volatile size_t sink = 0;
+        for (int repeat = 0; repeat < 5; ++repeat) {
+            const auto start = std::chrono::steady_clock::now();
+            size_t hits = 0;
+            for (const uint32_t pos : probePositions) {
+                hits += probe(pos);
+            }
+            hits += scan();
+            sink = sink + hits;
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+};
+
+// Representation currently used by an AdaptiveBitmap.
+enum class AdaptiveKind {
+    Array,
+    Dense,
+    Runs,
+};
+
+
+// A bitmap that switches between sorted array, dense words and runs as its density changes.
+template <int TMax, typename CheckPolicy = DefaultCheckPolicy>
+struct AdaptiveBitmap {
+    static constexpr size_t WordCount = WordsFor(static_cast<size_t>(TMax));
+
+    // A half-open interval [Start, Start + Length) of set positions.
+    struct Run {
+        uint32_t Start;
+        uint32_t Length;
+    };
+
+    // Run CheckPolicy on bitPos; false means the operation should be skipped.
+    static constexpr bool IsBitInRange(const int bitPos)
+    {
+        return CheckPolicy::Validate(bitPos, TMax);
+    }
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor initializes an empty bitmap in array form.
+    AdaptiveBitmap() = default;
+
+    // Variadic template constructor for setting bits during initialization.
+    template<typename...Args>
+        requires ((std::is_integral_v<Args> || std::is_enum_v<Args>) && ...)
+    AdaptiveBitmap(const Args&...bits)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Reset all bits to zero and return to array form.
+    void ResetAllBits() {
+        Kind = AdaptiveKind::Array;
+        Array.clear();
+        Words.clear();
+        Runs.clear();
+        Count = 0;
+    }
+
+    // Re-choose the representation from the current cardinality and run count.
+    void Optimize() {
+        const AdaptiveKind best = ChooseKind(Count, CountRuns());
+        if (best != Kind) {
+            ConvertTo(best);
+        }
+    }
+
+
+    // Bit Manipulation Functions:
+
+
+    // Set a specific bit at position bitPos.
+    void SetBit(const int bitPos)
+    {
+        if (!IsBitInRange(bitPos)) {
+            return;
+        }
+        const uint32_t pos = static_cast<uint32_t>(bitPos);
+        switch (Kind) {
+        case AdaptiveKind::Array: {
+            auto it = std::lower_bound(Array.begin(), Array.end(), pos);
+            if (it != Array.end() && *it == pos) {
+                return;
+            }
+            Array.insert(it, pos);
+            ++Count;
+            if (static_cast<size_t>(Count) > ArrayLimit()) {
+                Optimize();
+            }
+            break;
+        }
+        case AdaptiveKind::Dense: {
+            uint64_t& word = Words[pos / WordBits];
+            const uint64_t bit = uint64_t(1) << (pos % WordBits);
+            Count += (word & bit) == 0;
+            word |= bit;
+            break;
+        }
+        case AdaptiveKind::Runs:
+            if (InsertIntoRuns(pos)) {
+                ++Count;
+                if (Runs.size() > RunsLimit()) {
+                    Optimize();
+                }
+            }
+            break;
+        }
+    }
+
+    // Set multiple bits.
+    template<typename...Args>
+    void SetBits(const Args&... bits)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Clear a specific bit at position bitPos.
+    void ClearBit(const int bitPos)
+    {
+        if (!IsBitInRange(bitPos)) {
+            return;
+        }
+        const uint32_t pos = static_cast<uint32_t>(bitPos);
+        switch (Kind) {
+        case AdaptiveKind::Array: {
+            auto it = std::lower_bound(Array.begin(), Array.end(), pos);
+            if (it != Array.end() && *it == pos) {
+                Array.erase(it);
+                --Count;
+            }
+            break;
+        }
+        case AdaptiveKind::Dense: {
+            uint64_t& word = Words[pos / WordBits];
+            const uint64_t bit = uint64_t(1) << (pos % WordBits);
+            Count -= (word & bit) != 0;
+            word &= ~bit;
+            if (static_cast<size_t>(Count) * 2 < ArrayLimit()) {
+                Optimize();
+            }
+            break;
+        }
+        case AdaptiveKind::Runs:
+            if (RemoveFromRuns(pos)) {
+                --Count;
+                if (Runs.size() > RunsLimit()) {
+                    Optimize();
+                }
+            }
+            break;
+        }
+    }
+
+    // Clear multiple bits.
+    template<typename...Args>
+    void ClearBits(const Args&... bits)
+    {
+        (ClearBit(static_cast<int>(bits)), ...);
+    }
+
+    // Toggle a specific bit at position bitPos.
+    void ToggleBit(const int bitPos)
+    {
+        if (IsBitSet(bitPos)) {
+            ClearBit(bitPos);
+        }
+        else {
+            SetBit(bitPos);
+        }
+    }
+
+    // Toggle multiple bits.
+    template<typename...Args>
+    void ToggleBits(const Args&... bits)
+    {
+        (ToggleBit(static_cast<int>(bits)), ...);
+    }
+
+
+    // Query and Information:
+
+
+    // Representation in use.
+    AdaptiveKind Representation() const {
+        return Kind;
+    }
+
+    // Check if a specific bit at position pos is set.
+    bool IsBitSet(const int pos) const {
+        if (!IsBitInRange(pos)) {
+            return false;
+        }
+        const uint32_t value = static_cast<uint32_t>(pos);
+        switch (Kind) {
+        case AdaptiveKind::Array:
+            return std::binary_search(Array.begin(), Array.end(), value);
+        case AdaptiveKind::Dense:
+            return ((Words[value / WordBits] >> (value % WordBits)) & 1) != 0;
+        case AdaptiveKind::Runs: {
+            const auto it = RunAfter(value);
+            return it != Runs.begin() && value < std::prev(it)->Start + std::prev(it)->Length;
+        }
+        }
+        return false;
+    }
+
+    // Check if any bit is set.
+    bool AnyBitSet() const {
+        return Count != 0;
+    }
+
+    // Check if all TMax bits are set.
+    bool AllBitsSet() const {
+        return Count == TMax;
+    }
+
+    // Count the number of set bits.
+    int CountSetBits() const {
+        return Count;
+    }
+
+    // Check if any bit in this bitmap is also set in otherMask.
+    bool IsAnyBitSetInRange(const AdaptiveBitmap& otherMask) const {
+        bool found = false;
+        const AdaptiveBitmap& smaller = Count <= otherMask.Count ? *this : otherMask;
+        const AdaptiveBitmap& larger = Count <= otherMask.Count ? otherMask : *this;
+        smaller.ForEachSetBitUntil([&](int pos) { found = larger.IsBitSet(pos); return !found; });
+        return found;
+    }
+
+    // Position of the first set bit at or after pos, or TMax when there is none.
+    int FindNextSetBit(const int pos) const {
+        const uint32_t from = static_cast<uint32_t>(pos < 0 ? 0 : pos);
+        if (pos >= TMax) {
+            return TMax;
+        }
+        switch (Kind) {
+        case AdaptiveKind::Array: {
+            const auto it = std::lower_bound(Array.begin(), Array.end(), from);
+            return it != Array.end() ? static_cast<int>(*it) : TMax;
+        }
+        case AdaptiveKind::Dense: {
+            const size_t next = FindNextSetWords(Words.data(), WordCount, from);
+            return next < static_cast<size_t>(TMax) ? static_cast<int>(next) : TMax;
+        }
+        case AdaptiveKind::Runs: {
+            auto it = RunAfter(from);
+            if (it != Runs.begin() && from < std::prev(it)->Start + std::prev(it)->Length) {
+                return static_cast<int>(from);
+            }
+            return it != Runs.end() ? static_cast<int>(it->Start) : TMax;
+        }
+        }
+        return TMax;
+    }
+
+    // Call func(pos) for every set bit in increasing order.
+    template <typename Func>
+    void ForEachSetBit(Func&& func) const {
+        ForEachSetBitUntil([&](int pos) { func(pos); return true; });
+    }
+
+    // Copy of the bitmap as dense words.
+    std::vector<uint64_t> ToWords() const {
+        if (Kind == AdaptiveKind::Dense) {
+            return Words;
+        }
+        std::vector<uint64_t> words(WordCount, 0);
+        ForEachSetBit([&](int pos) { words[pos / WordBits] |= uint64_t(1) << (pos % WordBits); });
+        return words;
+    }
+
+    // Convert the bitmap to a binary string, highest bit first.
+    std::string toBinaryString() const {
+        std::string result(TMax, '0');
+        ForEachSetBit([&](int pos) { result[TMax - 1 - pos] = '1'; });
+        return result;
+    }
+
+
+    // Bitwise Operations:
+
+
+    AdaptiveBitmap operator+(const AdaptiveBitmap& other) const {
+        if (Kind == AdaptiveKind::Array && other.Kind == AdaptiveKind::Array) {
+            AdaptiveBitmap result;
+            std::set_union(Array.begin(), Array.end(), other.Array.begin(), other.Array.end(), std::back_inserter(result.Array));
+            return result.Finalize();
+        }
+        return CombineWords(other, OrWords);
+    }
+
+    AdaptiveBitmap operator-(const AdaptiveBitmap& other) const {
+        if (Kind == AdaptiveKind::Array) {
+            AdaptiveBitmap result;
+            for (const uint32_t pos : Array) {
+                if (!other.IsBitSet(static_cast<int>(pos))) {
+                    result.Array.push_back(pos);
+                }
+            }
+            return result.Finalize();
+        }
+        return CombineWords(other, AndNotWords);
+    }
+
+    AdaptiveBitmap operator&(const AdaptiveBitmap& other) const {
+        // An array operand bounds the result; probe its positions in the other bitmap.
+        if (Kind == AdaptiveKind::Array || other.Kind == AdaptiveKind::Array) {
+            const AdaptiveBitmap& array = Kind == AdaptiveKind::Array ? *this : other;
+            const AdaptiveBitmap& probe = Kind == AdaptiveKind::Array ? other : *this;
+            AdaptiveBitmap result;
+            for (const uint32_t pos : array.Array) {
+                if (probe.IsBitSet(static_cast<int>(pos))) {
+                    result.Array.push_back(pos);
+                }
+            }
+            return result.Finalize();
+        }
+        return CombineWords(other, AndWords);
+    }
+
+    AdaptiveBitmap operator^(const AdaptiveBitmap& other) const {
+        if (Kind == AdaptiveKind::Array && other.Kind == AdaptiveKind::Array) {
+            AdaptiveBitmap result;
+            std::set_symmetric_difference(Array.begin(), Array.end(), other.Array.begin(), other.Array.end(), std::back_inserter(result.Array));
+            return result.Finalize();
+        }
+        return CombineWords(other, XorWords);
+    }
+
+    AdaptiveBitmap& operator+=(const AdaptiveBitmap& other) {
+        return *this = *this + other;
+    }
+
+    AdaptiveBitmap& operator-=(const AdaptiveBitmap& other) {
+        return *this = *this - other;
+    }
+
+    AdaptiveBitmap& operator&=(const AdaptiveBitmap& other) {
+        return *this = *this & other;
+    }
+
+    AdaptiveBitmap& operator^=(const AdaptiveBitmap& other) {
+        return *this = *this ^ other;
+    }
+
+    AdaptiveBitmap operator~() const {
+        std::vector<uint64_t> words = ToWords();
+        NotWords(words.data(), WordCount);
+        words[WordCount - 1] &= LastWordMask(static_cast<size_t>(TMax));
+        return FromWords(std::move(words));
+    }
+
+    AdaptiveBitmap operator<<(int shift) const {
+        std::vector<uint64_t> words = ToWords();
+        ShiftLeftWords(words.data(), WordCount, static_cast<size_t>(shift));
+        words[WordCount - 1] &= LastWordMask(static_cast<size_t>(TMax));
+        return FromWords(std::move(words));
+    }
+
+    AdaptiveBitmap operator>>(int shift) const {
+        std::vector<uint64_t> words = ToWords();
+        ShiftRightWords(words.data(), WordCount, static_cast<size_t>(shift));
+        return FromWords(std::move(words));
+    }
+
+    AdaptiveBitmap& operator<<=(int shift) {
+        return *this = *this << shift;
+    }
+
+    AdaptiveBitmap& operator>>=(int shift) {
+        return *this = *this >> shift;
+    }
+
+    bool operator==(const AdaptiveBitmap& other) const {
+        if (Count != other.Count) {
+            return false;
+        }
+        if (Kind == other.Kind && Kind == AdaptiveKind::Array) {
+            return Array == other.Array;
+        }
+        if (Kind == other.Kind && Kind == AdaptiveKind::Dense) {
+            return Words == other.Words;
+        }
+        return ToWords() == other.ToWords();
+    }
+
+    bool operator!=(const AdaptiveBitmap& other) const {
+        return !(*this == other);
+    }
+
+private:
+    static size_t ArrayLimit() {
+        return static_cast<size_t>(AdaptiveThresholds::Current().ArrayMaxDensity * TMax);
+    }
+
+    static size_t RunsLimit() {
+        return static_cast<size_t>(AdaptiveThresholds::Current().RunsMaxDensity * TMax);
+    }
+
+    // Cheapest representation for count set bits forming runCount runs.
+    static AdaptiveKind ChooseKind(const size_t count, const size_t runCount) {
+        const bool runsFit = runCount <= RunsLimit();
+        if (runsFit && runCount * 2 < count) {
+            return AdaptiveKind::Runs;
+        }
+        if (count <= ArrayLimit()) {
+            return AdaptiveKind::Array;
+        }
+        return runsFit ? AdaptiveKind::Runs : AdaptiveKind::Dense;
+    }
+
+    // Number of maximal runs of set bits.
+    size_t CountRuns() const {
+        switch (Kind) {
+        case AdaptiveKind::Array: {
+            size_t runs = 0;
+            for (size_t i = 0; i < Array.size(); ++i) {
+                runs += i == 0 || Array[i] != Array[i - 1] + 1;
+            }
+            return runs;
+        }
+        case AdaptiveKind::Dense: {
+            // A run starts at every set bit whose lower neighbour is clear.
+            size_t runs = 0;
+            uint64_t carry = 0;
+            for (const uint64_t word : Words) {
+                runs += static_cast<size_t>(std::popcount(word & ~((word << 1) | carry)));
+                carry = word >> (WordBits - 1);
+            }
+            return runs;
+        }
+        case AdaptiveKind::Runs:
+            return Runs.size();
+        }
+        return 0;
+    }
+
+    template <typename Func>
+    void ForEachSetBitUntil(Func&& func) const {
+        switch (Kind) {
+        case AdaptiveKind::Array:
+            for (const uint32_t pos : Array) {
+                if (!func(static_cast<int>(pos))) {
+                    return;
+                }
+            }
+            break;
+        case AdaptiveKind::Dense:
+            for (size_t i = 0; i < WordCount; ++i) {
+                uint64_t word = Words[i];
+                while (word != 0) {
+                    if (!func(static_cast<int>(i * WordBits + std::countr_zero(word)))) {
+                        return;
+                    }
+                    word &= word - 1;
+                }
+            }
+            break;
+        case AdaptiveKind::Runs:
+            for (const Run& run : Runs) {
+                for (uint32_t pos = run.Start; pos < run.Start + run.Length; ++pos) {
+                    if (!func(static_cast<int>(pos))) {
+                        return;
+                    }
+                }
+            }
+            break;
+        }
+    }
+
+    // First run starting after pos.
+    typename std::vector<Run>::const_iterator RunAfter(const uint32_t pos) const {
+        return std::upper_bound(Runs.begin(), Runs.end(), pos, [](uint32_t value, const Run& run) { return value < run.Start; });
+    }
+
+    // Add pos to the runs, extending or joining neighbours; returns false if it was already set.
+    bool InsertIntoRuns(const uint32_t pos) {
+        auto it = Runs.begin() + (RunAfter(pos) - Runs.begin());
+        if (it != Runs.begin()) {
+            Run& before = *std::prev(it);
+            if (pos < before.Start + before.Length) {
+                return false;
+            }
+            if (pos == before.Start + before.Length) {
+                ++before.Length;
+                if (it != Runs.end() && it->Start == pos + 1) {
+                    before.Length += it->Length;
+                    Runs.erase(it);
+                }
+                return true;
+            }
+        }
+        if (it != Runs.end() && it->Start == pos + 1) {
+            --it->Start;
+            ++it->Length;
+            return true;
+        }
+        Runs.insert(it, Run{ pos, 1 });
+        return true;
+    }
+
+    // Remove pos from the runs, splitting a run if needed; returns false if it was not set.
+    bool RemoveFromRuns(const uint32_t pos) {
+        auto after = RunAfter(pos);
+        if (after == Runs.begin()) {
+            return false;
+        }
+        const size_t index = static_cast<size_t>(after - Runs.begin()) - 1;
+        Run& run = Runs[index];
+        const uint32_t end = run.Start + run.Length;
+        if (pos >= end) {
+            return false;
+        }
+        if (run.Length == 1) {
+            Runs.erase(Runs.begin() + index);
+        }
+        else if (pos == run.Start) {
+            ++run.Start;
+            --run.Length;
+        }
+        else if (pos == end - 1) {
+            --run.Length;
+        }
+        else {
+            run.Length = pos - run.Start;
+            Runs.insert(Runs.begin() + index + 1, Run{ pos + 1, end - pos - 1 });
+        }
+        return true;
+    }
+
+    // Rebuild the contents in the given representation.
+    void ConvertTo(const AdaptiveKind kind) {
+        std::vector<uint32_t> array;
+        std::vector<uint64_t> words;
+        std::vector<Run> runs;
+        if (kind == AdaptiveKind::Dense) {
+            words = ToWords();
+        }
+        else {
+            ForEachSetBit([&](int bit) {
+                const uint32_t pos = static_cast<uint32_t>(bit);
+                if (kind == AdaptiveKind::Array) {
+                    array.push_back(pos);
+                }
+                else if (!runs.empty() && runs.back().Start + runs.back().Length == pos) {
+                    ++runs.back().Length;
+                }
+                else {
+                    runs.push_back(Run{ pos, 1 });
+                }
+            });
+        }
+        Array.swap(array);
+        Words.swap(words);
+        Runs.swap(runs);
+        Kind = kind;
+    }
+
+    // Take a freshly built sorted array as the contents and pick the best representation.
+    AdaptiveBitmap& Finalize() {
+        Kind = AdaptiveKind::Array;
+        Count = static_cast<int>(Array.size());
+        Optimize();
+        return *this;
+    }
+
+    static AdaptiveBitmap FromWords(std::vector<uint64_t> words) {
+        AdaptiveBitmap result;
+        result.Kind = AdaptiveKind::Dense;
+        result.Count = static_cast<int>(PopCountWords(words.data(), WordCount));
+        result.Words = std::move(words);
+        result.Optimize();
+        return result;
+    }
+
+    template <typename Kernel>
+    AdaptiveBitmap CombineWords(const AdaptiveBitmap& other, Kernel&& kernel) const {
+        std::vector<uint64_t> words = ToWords();
+        if (other.Kind == AdaptiveKind::Dense) {
+            kernel(words.data(), other.Words.data(), WordCount);
+        }
+        else {
+            const std::vector<uint64_t> otherWords = other.ToWords();
+            kernel(words.data(), otherWords.data(), WordCount);
+        }
+        return FromWords(std::move(words));
+    }
+
+    AdaptiveKind Kind = AdaptiveKind::Array;
+    std::vector<uint32_t> Array;
+    std::vector<uint64_t> Words;
+    std::vector<Run> Runs;
+    int Count = 0;
+};
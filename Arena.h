@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/*
+BumpArena hands out memory from large blocks by advancing an offset, so allocation is a pointer bump
+and nothing is freed individually; every block is released when the arena is destroyed. Containers
+that take a BumpArena (HamtMap, SparseArray) use it for their nodes / value arrays instead of the
+heap. An arena is not synchronized.
+*/
+
+
+// Bump allocator; memory is released only when the arena is destroyed.
+struct BumpArena {
+    explicit BumpArena(const size_t blockBytes = size_t(1) << 16) : BlockBytes(blockBytes) {}
+
+    BumpArena(const BumpArena&) = delete;
+    BumpArena& operator=(const BumpArena&) = delete;
+
+    // Allocate bytes aligned to max_align_t.
+    void* Allocate(size_t bytes)
+    {
+        bytes = (bytes + Alignment - 1) & ~(Alignment - 1);
+        if (Blocks.empty() || Used + bytes > CurrentBlockBytes) {
+            CurrentBlockBytes = std::max(BlockBytes, bytes);
+            Blocks.push_back(std::make_unique<std::byte[]>(CurrentBlockBytes));
+            Used = 0;
+        }
+        void* memory = Blocks.back().get() + Used;
+        Used += bytes;
+        Allocated += bytes;
+        return memory;
+    }
+
+    // Bytes handed out so far.
+    size_t BytesAllocated() const {
+        return Allocated;
+    }
+
+private:
+    static constexpr size_t Alignment = alignof(std::max_align_t);
+
+    size_t BlockBytes;
+    std::vector<std::unique_ptr<std::byte[]>> Blocks;
+    size_t CurrentBlockBytes = 0;
+    size_t Used = 0;
+    size_t Allocated = 0;
+};
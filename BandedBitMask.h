@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "WideBitMask.h"
+
+/*
+BandedBitMask is an opt-in WideBitMask variant that tracks its active word range.
+
+-LowWord / HighWord are the first and last non-zero words; every word outside them is zero, and an
+ empty mask has LowWord > HighWord.
+-Setting a bit widens the range in O(1). Operations that can clear words shrink it by stepping
+ inwards past the zero words at its edges, which only ever touches words inside the old range.
+-Operators, counting, comparison, shifts and iteration only visit the active range, so a mask whose
+ bits sit in a narrow band costs O(band) instead of O(TMax).
+*/
+
+
+// A wide mask whose operations only touch the words between its lowest and highest set bit.
+template <int TMax, typename CheckPolicy = DefaultCheckPolicy>
+struct BandedBitMask {
+    using Dense = WideBitMask<TMax, CheckPolicy>;
+    static constexpr size_t WordCount = Dense::WordCount;
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor initializes an empty mask.
+    BandedBitMask() = default;
+
+    // Variadic template constructor for setting bits during initialization.
+    template<typename...Args>
+        requires ((std::is_integral_v<Args> || std::is_enum_v<Args>) && ...)
+    BandedBitMask(const Args&...bits)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Wrap an existing wide mask, finding its active range once.
+    explicit BandedBitMask(const Dense& bits) : Bits(bits), LowWord(0), HighWord(WordCount - 1)
+    {
+        Shrink();
+    }
+
+    // Reset all bits to zero, clearing only the active range.
+    void ResetAllBits() {
+        for (size_t i = LowWord; i <= HighWord && i < WordCount; ++i) {
+            Bits.Words[i] = 0;
+        }
+        LowWord = WordCount;
+        HighWord = 0;
+    }
+
+
+    // Bit Manipulation Functions:
+
+
+    // Set a specific bit at position bitPos, widening the active range if needed.
+    void SetBit(const int bitPos)
+    {
+        if (Dense::IsBitInRange(bitPos)) {
+            const size_t index = static_cast<size_t>(bitPos) / WordBits;
+            Bits.Words[index] |= uint64_t(1) << (bitPos % WordBits);
+            Widen(index, index);
+        }
+    }
+
+    // Set multiple bits.
+    template<typename...Args>
+    void SetBits(const Args&... bits)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Clear a specific bit at position bitPos.
+    void ClearBit(const int bitPos)
+    {
+        if (Dense::IsBitInRange(bitPos)) {
+            const size_t index = static_cast<size_t>(bitPos) / WordBits;
+            Bits.Words[index] &= ~(uint64_t(1) << (bitPos % WordBits));
+            if (Bits.Words[index] == 0 && (index == LowWord || index == HighWord)) {
+                Shrink();
+            }
+        }
+    }
+
+    // Clear multiple bits.
+    template<typename...Args>
+    void ClearBits(const Args&... bits)
+    {
+        (ClearBit(static_cast<int>(bits)), ...);
+    }
+
+    // Toggle a specific bit at position bitPos.
+    void ToggleBit(const int bitPos)
+    {
+        if (IsBitSet(bitPos)) {
+            ClearBit(bitPos);
+        }
+        else {
+            SetBit(bitPos);
+        }
+    }
+
+    // Toggle multiple bits.
+    template<typename...Args>
+    void ToggleBits(const Args&... bits)
+    {
+        (ToggleBit(static_cast<int>(bits)), ...);
+    }
+
+
+    // Query and Information:
+
+
+    // Check if a specific bit at position pos is set.
+    bool IsBitSet(const int pos) const {
+        return Bits.IsBitSet(pos);
+    }
+
+    // Check if any bit is set, in O(1).
+    bool AnyBitSet() const {
+        return !IsEmptyRange();
+    }
+
+    // Check if all TMax bits are set.
+    bool AllBitsSet() const {
+        return LowWord == 0 && HighWord == WordCount - 1 && CountSetBits() == TMax;
+    }
+
+    // Count the number of set bits within the active range.
+    int CountSetBits() const {
+        return IsEmptyRange() ? 0 : static_cast<int>(PopCountWords(Bits.Words.data() + LowWord, RangeWords()));
+    }
+
+    // Check if any bit in this mask is also set in otherMask, looking only where both ranges overlap.
+    bool IsAnyBitSetInRange(const BandedBitMask& otherMask) const {
+        const size_t low = std::max(LowWord, otherMask.LowWord);
+        const size_t high = std::min(HighWord, otherMask.HighWord);
+        return low <= high && IntersectsWords(Bits.Words.data() + low, otherMask.Bits.Words.data() + low, high - low + 1);
+    }
+
+    // Position of the lowest set bit, or TMax when the mask is empty.
+    int FindFirstSetBit() const {
+        return FindNextSetBit(0);
+    }
+
+    // Position of the first set bit at or after pos, or TMax when there is none.
+    int FindNextSetBit(const int pos) const {
+        if (IsEmptyRange() || pos >= TMax) {
+            return TMax;
+        }
+        const size_t from = std::max(static_cast<size_t>(pos < 0 ? 0 : pos), LowWord * WordBits);
+        const size_t next = FindNextSetWords(Bits.Words.data(), HighWord + 1, from);
+        return next < (HighWord + 1) * WordBits ? static_cast<int>(next) : TMax;
+    }
+
+    // Call func(pos) for every set bit in increasing order, visiting only the active range.
+    template <typename Func>
+    void ForEachSetBit(Func&& func) const {
+        for (size_t i = LowWord; i <= HighWord && i < WordCount; ++i) {
+            uint64_t word = Bits.Words[i];
+            while (word != 0) {
+                func(static_cast<int>(i * WordBits + std::countr_zero(word)));
+                word &= word - 1;
+            }
+        }
+    }
+
+    // First and last non-zero word; LowWord > HighWord when the mask is empty.
+    size_t FirstActiveWord() const {
+        return LowWord;
+    }
+
+    size_t LastActiveWord() const {
+        return HighWord;
+    }
+
+    // The underlying wide mask.
+    const Dense& ToDense() const {
+        return Bits;
+    }
+
+    // Convert the mask to a binary string, highest bit first.
+    std::string toBinaryString() const {
+        return Bits.toBinaryString();
+    }
+
+
+    // Bitwise Operations:
+
+
+    BandedBitMask operator+(const BandedBitMask& other) const {
+        BandedBitMask result(*this);
+        return result += other;
+    }
+
+    BandedBitMask operator-(const BandedBitMask& other) const {
+        BandedBitMask result(*this);
+        return result -= other;
+    }
+
+    BandedBitMask operator&(const BandedBitMask& other) const {
+        BandedBitMask result(*this);
+        return result &= other;
+    }
+
+    BandedBitMask operator^(const BandedBitMask& other) const {
+        BandedBitMask result(*this);
+        return result ^= other;
+    }
+
+    // OR only needs the other mask's range; ours is already in place.
+    BandedBitMask& operator+=(const BandedBitMask& other) {
+        if (!other.IsEmptyRange()) {
+            OrWords(Bits.Words.data() + other.LowWord, other.Bits.Words.data() + other.LowWord, other.RangeWords());
+            Widen(other.LowWord, other.HighWord);
+        }
+        return *this;
+    }
+
+    // AND-NOT can only change words where both ranges overlap.
+    BandedBitMask& operator-=(const BandedBitMask& other) {
+        const size_t low = std::max(LowWord, other.LowWord);
+        const size_t high = std::min(HighWord, other.HighWord);
+        if (low <= high) {
+            AndNotWords(Bits.Words.data() + low, other.Bits.Words.data() + low, high - low + 1);
+            Shrink();
+        }
+        return *this;
+    }
+
+    // AND keeps the overlap of both ranges and zeroes the rest of ours.
+    BandedBitMask& operator&=(const BandedBitMask& other) {
+        const size_t low = std::max(LowWord, other.LowWord);
+        const size_t high = std::min(HighWord, other.HighWord);
+        if (low > high) {
+            ResetAllBits();
+            return *this;
+        }
+        for (size_t i = LowWord; i < low; ++i) {
+            Bits.Words[i] = 0;
+        }
+        for (size_t i = high + 1; i <= HighWord; ++i) {
+            Bits.Words[i] = 0;
+        }
+        AndWords(Bits.Words.data() + low, other.Bits.Words.data() + low, high - low + 1);
+        LowWord = low;
+        HighWord = high;
+        Shrink();
+        return *this;
+    }
+
+    BandedBitMask& operator^=(const BandedBitMask& other) {
+        if (!other.IsEmptyRange()) {
+            XorWords(Bits.Words.data() + other.LowWord, other.Bits.Words.data() + other.LowWord, other.RangeWords());
+            Widen(other.LowWord, other.HighWord);
+            Shrink();
+        }
+        return *this;
+    }
+
+    BandedBitMask operator~() const {
+        return BandedBitMask(~Bits);
+    }
+
+    BandedBitMask operator<<(int shift) const {
+        BandedBitMask result(*this);
+        return result <<= shift;
+    }
+
+    BandedBitMask operator>>(int shift) const {
+        BandedBitMask result(*this);
+        return result >>= shift;
+    }
+
+    // Shift inside a window that covers the active range and its destination.
+    BandedBitMask& operator<<=(int shift) {
+        if (IsEmptyRange() || shift <= 0) {
+            return shift < 0 ? (*this >>= -shift) : *this;
+        }
+        const size_t wordShift = static_cast<size_t>(shift) / WordBits;
+        if (LowWord + wordShift >= WordCount) {
+            ResetAllBits();
+            return *this;
+        }
+        const size_t high = std::min(WordCount - 1, HighWord + wordShift + 1);
+        ShiftLeftWords(Bits.Words.data() + LowWord, high - LowWord + 1, static_cast<size_t>(shift));
+        Bits.TrimTail();
+        HighWord = high;
+        Shrink();
+        return *this;
+    }
+
+    BandedBitMask& operator>>=(int shift) {
+        if (IsEmptyRange() || shift <= 0) {
+            return shift < 0 ? (*this <<= -shift) : *this;
+        }
+        const size_t wordShift = static_cast<size_t>(shift) / WordBits;
+        if (wordShift > HighWord) {
+            ResetAllBits();
+            return *this;
+        }
+        const size_t low = LowWord > wordShift ? LowWord - wordShift - 1 : 0;
+        ShiftRightWords(Bits.Words.data() + low, HighWord - low + 1, static_cast<size_t>(shift));
+        LowWord = low;
+        Shrink();
+        return *this;
+    }
+
+    // Masks with different active ranges can never be equal; otherwise only the range is compared.
+    bool operator==(const BandedBitMask& other) const {
+        if (IsEmptyRange() || other.IsEmptyRange()) {
+            return IsEmptyRange() == other.IsEmptyRange();
+        }
+        return LowWord == other.LowWord && HighWord == other.HighWord
+            && EqualWords(Bits.Words.data() + LowWord, other.Bits.Words.data() + LowWord, RangeWords());
+    }
+
+    bool operator!=(const BandedBitMask& other) const {
+        return !(*this == other);
+    }
+
+private:
+    bool IsEmptyRange() const {
+        return LowWord > HighWord;
+    }
+
+    size_t RangeWords() const {
+        return HighWord - LowWord + 1;
+    }
+
+    // Grow the active range to include [low, high].
+    void Widen(const size_t low, const size_t high) {
+        if (IsEmptyRange()) {
+            LowWord = low;
+            HighWord = high;
+            return;
+        }
+        LowWord = std::min(LowWord, low);
+        HighWord = std::max(HighWord, high);
+    }
+
+    // Step both edges inwards past zero words so they point at non-zero words again.
+    void Shrink() {
+        while (LowWord <= HighWord && LowWord < WordCount && Bits.Words[LowWord] == 0) {
+            ++LowWord;
+        }
+        while (HighWord > LowWord && Bits.Words[HighWord] == 0) {
+            --HighWord;
+        }
+        if (LowWord > HighWord || LowWord >= WordCount) {
+            LowWord = WordCount;
+            HighWord = 0;
+        }
+    }
+
+    Dense Bits;
+    size_t LowWord = WordCount;
+    size_t HighWord = 0;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "DynamicBitMask.h"
+
+/*
+BitMatrix is the adjacency matrix of an undirected graph with one DynamicBitMask row per vertex.
+
+-Row(v) has bit u set when u and v are adjacent, so neighborhoods combine with the word kernels:
+ candidate filtering is a row AND and common neighbor counts are AND-popcounts.
+-Memory is n * n bits, which suits dense graphs of up to some tens of thousands of vertices.
+*/
+
+
+// Symmetric adjacency bit matrix.
+struct BitMatrix {
+
+
+    // Constructors and Initialization:
+
+
+    // Graph of vertexCount vertices and no edges.
+    explicit BitMatrix(const int vertexCount)
+        : Rows(static_cast<size_t>(CheckedCount(vertexCount)), DynamicBitMask<>(vertexCount)) {}
+
+    // Add the undirected edge a - b; self loops are ignored.
+    void AddEdge(const int a, const int b)
+    {
+        if (a < 0 || b < 0 || a >= VertexCount() || b >= VertexCount()) {
+            throw std::out_of_range("BitMatrix edge has a vertex outside the graph");
+        }
+        if (a != b) {
+            Rows[static_cast<size_t>(a)].SetBit(b);
+            Rows[static_cast<size_t>(b)].SetBit(a);
+        }
+    }
+
+
+    // Query and Information:
+
+
+    int VertexCount() const {
+        return static_cast<int>(Rows.size());
+    }
+
+    bool HasEdge(const int a, const int b) const {
+        return Rows[static_cast<size_t>(a)].IsBitSet(b);
+    }
+
+    int Degree(const int v) const {
+        return Rows[static_cast<size_t>(v)].CountSetBits();
+    }
+
+    // Neighbors of v.
+    const DynamicBitMask<>& Row(const int v) const {
+        return Rows[static_cast<size_t>(v)];
+    }
+
+    std::vector<DynamicBitMask<>> Rows;
+
+private:
+    static int CheckedCount(const int vertexCount)
+    {
+        if (vertexCount < 0) {
+            throw std::invalid_argument("BitMatrix needs a non-negative vertex count");
+        }
+        return vertexCount;
+    }
+};
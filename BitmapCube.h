@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "DynamicBitMask.h"
+#include "Parallel.h"
+#include "WordKernels.h"
+
+/*
+BitmapCube answers GROUP BY ... COUNT(*) queries over up to three dimensions with bitmap popcounts.
+
+-Every dimension value owns a DynamicBitMask over the rows that have that value.
+-GroupBy(dimensions) counts every combination of values as the popcount of the AND of the value
+ bitmaps (and an optional row filter), using AndPopCountWordsN so the intersections are never
+ materialized; each cell is one streaming pass over its operands.
+-The flattened cell range (outer combinations of all but the last grouped dimension, times the
+ values of the last one) is split across threads, so a single-dimension GROUP BY, or one with few
+ outer combinations, still uses every worker. A combination whose outer bitmaps are empty, or whose
+ outer intersection counts zero, skips its inner cells.
+*/
+
+
+// Dense COUNT(*) results of a GROUP BY, one cell per combination of values.
+struct CubeCounts {
+    std::vector<int> Dimensions;
+    std::vector<int> ValueCounts;
+    std::vector<size_t> Counts;
+
+    // Count of the cell with the given value of each grouped dimension, in GroupBy order.
+    template <typename...Values>
+    size_t Cell(const Values...values) const {
+        if (sizeof...(Values) != Dimensions.size()) {
+            throw std::invalid_argument("CubeCounts::Cell needs one value per grouped dimension");
+        }
+        size_t index = 0;
+        size_t dimension = 0;
+        ((index = index * static_cast<size_t>(ValueCounts[dimension++]) + static_cast<size_t>(values)), ...);
+        return Counts[index];
+    }
+
+    // Call func(values, count) for every non-empty cell; values points at one value per dimension.
+    template <typename Func>
+    void ForEachGroup(Func&& func) const {
+        std::vector<int> values(Dimensions.size(), 0);
+        for (size_t cell = 0; cell < Counts.size(); ++cell) {
+            size_t rest = cell;
+            for (size_t d = Dimensions.size(); d-- > 0;) {
+                values[d] = static_cast<int>(rest % static_cast<size_t>(ValueCounts[d]));
+                rest /= static_cast<size_t>(ValueCounts[d]);
+            }
+            if (Counts[cell] != 0) {
+                func(values.data(), Counts[cell]);
+            }
+        }
+    }
+};
+
+// Per-dimension value bitmaps over a fixed set of rows.
+struct BitmapCube {
+    static constexpr size_t MaxGroupDimensions = 3;
+
+
+    // Constructors and Initialization:
+
+
+    explicit BitmapCube(const int rowCount) : Rows(rowCount)
+    {
+        if (rowCount < 0) {
+            throw std::invalid_argument("BitmapCube needs a non-negative row count");
+        }
+    }
+
+    // Add a dimension with values 0 .. valueCount - 1 and return its index.
+    int AddDimension(const int valueCount)
+    {
+        if (valueCount <= 0) {
+            throw std::invalid_argument("BitmapCube dimensions need at least one value");
+        }
+        Values.emplace_back(static_cast<size_t>(valueCount), DynamicBitMask<>(Rows));
+        return static_cast<int>(Values.size()) - 1;
+    }
+
+    // Record that row has value in dimension. A row should get exactly one value per dimension.
+    void SetRowValue(const int dimension, const int row, const int value)
+    {
+        Values.at(static_cast<size_t>(dimension)).at(static_cast<size_t>(value)).SetBit(row);
+    }
+
+
+    // Query and Information:
+
+
+    int RowCount() const {
+        return Rows;
+    }
+
+    int DimensionCount() const {
+        return static_cast<int>(Values.size());
+    }
+
+    int ValueCount(const int dimension) const {
+        return static_cast<int>(Values.at(static_cast<size_t>(dimension)).size());
+    }
+
+    // Rows that have value in dimension.
+    const DynamicBitMask<>& ValueRows(const int dimension, const int value) const {
+        return Values.at(static_cast<size_t>(dimension)).at(static_cast<size_t>(value));
+    }
+
+
+    // Aggregation:
+
+
+    // COUNT(*) for every combination of values of 1 to 3 dimensions, restricted to filter's rows if given.
+    CubeCounts GroupBy(const std::vector<int>& dimensions, const DynamicBitMask<>* filter = nullptr) const
+    {
+        if (dimensions.empty() || dimensions.size() > MaxGroupDimensions) {
+            throw std::invalid_argument("BitmapCube::GroupBy groups by one to three dimensions");
+        }
+        if (filter != nullptr && filter->Size() != Rows) {
+            throw std::invalid_argument("BitmapCube::GroupBy filter has a different row count");
+        }
+        CubeCounts result;
+        result.Dimensions = dimensions;
+        size_t outerCells = 1;
+        for (const int dimension : dimensions) {
+            result.ValueCounts.push_back(ValueCount(dimension));
+        }
+        for (size_t d = 0; d + 1 < dimensions.size(); ++d) {
+            outerCells *= static_cast<size_t>(result.ValueCounts[d]);
+        }
+        const size_t innerCells = static_cast<size_t>(result.ValueCounts.back());
+        result.Counts.assign(outerCells * innerCells, 0);
+
+        // Empty value bitmaps can be skipped without touching their words.
+        std::vector<std::vector<char>> nonEmpty(dimensions.size());
+        for (size_t d = 0; d < dimensions.size(); ++d) {
+            for (const DynamicBitMask<>& rows : Values[static_cast<size_t>(dimensions[d])]) {
+                nonEmpty[d].push_back(rows.AnyBitSet() ? 1 : 0);
+            }
+        }
+
+        const size_t wordCount = WordsFor(static_cast<size_t>(Rows));
+        const std::vector<DynamicBitMask<>>& inner = Values[static_cast<size_t>(dimensions.back())];
+        ParallelChunks(result.Counts.size(), WorkerCount(), [&](unsigned, size_t begin, size_t end) {
+            const uint64_t* operands[MaxGroupDimensions + 1];
+            // A chunk may start or end inside an outer combination; it handles only its own cells.
+            for (size_t outer = begin / innerCells; outer * innerCells < end; ++outer) {
+                // Outer operands: the filter, then one value bitmap per outer dimension.
+                size_t operandCount = 0;
+                if (filter != nullptr) {
+                    operands[operandCount++] = filter->Words.data();
+                }
+                bool empty = false;
+                size_t rest = outer;
+                for (size_t d = dimensions.size() - 1; d-- > 0;) {
+                    const size_t value = rest % static_cast<size_t>(result.ValueCounts[d]);
+                    rest /= static_cast<size_t>(result.ValueCounts[d]);
+                    empty = empty || !nonEmpty[d][value];
+                    operands[operandCount++] = Values[static_cast<size_t>(dimensions[d])][value].Words.data();
+                }
+                if (empty || (operandCount >= 2 && AndPopCount(operands, operandCount, wordCount) == 0)) {
+                    continue;
+                }
+                const size_t first = std::max(begin, outer * innerCells) - outer * innerCells;
+                const size_t last = std::min(end, (outer + 1) * innerCells) - outer * innerCells;
+                for (size_t value = first; value < last; ++value) {
+                    if (nonEmpty.back()[value]) {
+                        operands[operandCount] = inner[value].Words.data();
+                        result.Counts[outer * innerCells + value] = AndPopCount(operands, operandCount + 1, wordCount);
+                    }
+                }
+            }
+        });
+        return result;
+    }
+
+private:
+    // Dispatch to the fused kernel for the number of operands in use.
+    static size_t AndPopCount(const uint64_t* const* operands, const size_t operandCount, const size_t wordCount)
+    {
+        switch (operandCount) {
+        case 1: {
+            const uint64_t* const list[1] = { operands[0] };
+            return AndPopCountWordsN(list, wordCount);
+        }
+        case 2: {
+            const uint64_t* const list[2] = { operands[0], operands[1] };
+            return AndPopCountWordsN(list, wordCount);
+        }
+        case 3: {
+            const uint64_t* const list[3] = { operands[0], operands[1], operands[2] };
+            return AndPopCountWordsN(list, wordCount);
+        }
+        default: {
+            const uint64_t* const list[4] = { operands[0], operands[1], operands[2], operands[3] };
+            return AndPopCountWordsN(list, wordCount);
+        }
+        }
+    }
+
+    int Rows;
+    std::vector<std::vector<DynamicBitMask<>>> Values;
+};
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Parallel.h"
+#include "WideBitMask.h"
+
+/*
+BitmapDelta is a compact encoding of the change between two versions of a word bitmap.
+
+-Encode() stores old ^ new as blocks of [varint zero-word gap][varint literal count][literal words],
+ so unchanged words cost nothing and the encoded size follows the number of changed words.
+-ApplyTo() XORs the delta into a bitmap while decoding; it never materializes the full XOR. Every
+ block is checked against WordCount and the remaining bytes before it is read, and the whole delta
+ is decoded once before any word is written, so a malformed or corrupted delta throws runtime_error
+ and leaves the bitmap unchanged.
+-Combine() merges two deltas without decoding them to full size, either as XOR (deltas of
+ consecutive versions) or OR (add-only deltas from several nodes against the same base, whose union
+ is base | d1 | d2 ...). ReduceDeltas() applies Combine as a pairwise tree, one level at a time with
+ the pairs of a level combined in parallel.
+*/
+
+
+// How two deltas are combined.
+enum class DeltaMerge {
+    Xor,
+    Or,
+};
+
+// old ^ new of a word bitmap, run-length and varint encoded.
+struct BitmapDelta {
+    std::vector<uint8_t> Bytes;
+    size_t WordCount = 0;
+
+
+    // Encoding:
+
+
+    // Encode the change from oldWords to newWords, both wordCount words long.
+    static BitmapDelta Encode(const uint64_t* oldWords, const uint64_t* newWords, const size_t wordCount)
+    {
+        Writer writer(wordCount);
+        for (size_t i = 0; i < wordCount; ++i) {
+            const uint64_t changed = oldWords[i] ^ newWords[i];
+            if (changed != 0) {
+                writer.Append(i, changed);
+            }
+        }
+        return writer.Finish();
+    }
+
+    // Encode the change between two wide masks.
+    template <int TMax, typename CheckPolicy>
+    static BitmapDelta Encode(const WideBitMask<TMax, CheckPolicy>& oldMask, const WideBitMask<TMax, CheckPolicy>& newMask)
+    {
+        return Encode(oldMask.Words.data(), newMask.Words.data(), WideBitMask<TMax, CheckPolicy>::WordCount);
+    }
+
+
+    // Applying:
+
+
+    // XOR the delta into words, which must hold WordCount words.
+    void ApplyTo(uint64_t* words, const size_t wordCount) const
+    {
+        if (wordCount != WordCount) {
+            throw std::invalid_argument("BitmapDelta applied to a bitmap of a different size");
+        }
+        // Decode once without writing, so a malformed delta leaves the bitmap untouched.
+        CountSetBits();
+        Reader reader(*this);
+        size_t index = 0;
+        uint64_t word = 0;
+        while (reader.Next(index, word)) {
+            words[index] ^= word;
+        }
+    }
+
+    // XOR the delta into a wide mask.
+    template <int TMax, typename CheckPolicy>
+    void ApplyTo(WideBitMask<TMax, CheckPolicy>& mask) const
+    {
+        ApplyTo(mask.Words.data(), WideBitMask<TMax, CheckPolicy>::WordCount);
+        mask.TrimTail();
+    }
+
+
+    // Query and Information:
+
+
+    // Check if the delta changes nothing.
+    bool IsEmpty() const {
+        Reader reader(*this);
+        size_t index = 0;
+        uint64_t word = 0;
+        return !reader.Next(index, word);
+    }
+
+    // Number of bits the delta flips.
+    size_t CountSetBits() const {
+        Reader reader(*this);
+        size_t index = 0;
+        uint64_t word = 0;
+        size_t count = 0;
+        while (reader.Next(index, word)) {
+            count += static_cast<size_t>(std::popcount(word));
+        }
+        return count;
+    }
+
+
+    // Merging:
+
+
+    // Merge two deltas of the same bitmap size in one streaming pass over their encodings.
+    static BitmapDelta Combine(const BitmapDelta& a, const BitmapDelta& b, const DeltaMerge mode)
+    {
+        if (a.WordCount != b.WordCount) {
+            throw std::invalid_argument("BitmapDelta::Combine needs deltas of the same bitmap size");
+        }
+        Writer writer(a.WordCount);
+        Reader readerA(a);
+        Reader readerB(b);
+        size_t indexA = 0;
+        size_t indexB = 0;
+        uint64_t wordA = 0;
+        uint64_t wordB = 0;
+        bool hasA = readerA.Next(indexA, wordA);
+        bool hasB = readerB.Next(indexB, wordB);
+        while (hasA || hasB) {
+            if (hasA && (!hasB || indexA < indexB)) {
+                writer.Append(indexA, wordA);
+                hasA = readerA.Next(indexA, wordA);
+            }
+            else if (hasB && (!hasA || indexB < indexA)) {
+                writer.Append(indexB, wordB);
+                hasB = readerB.Next(indexB, wordB);
+            }
+            else {
+                const uint64_t merged = mode == DeltaMerge::Xor ? (wordA ^ wordB) : (wordA | wordB);
+                if (merged != 0) {
+                    writer.Append(indexA, merged);
+                }
+                hasA = readerA.Next(indexA, wordA);
+                hasB = readerB.Next(indexB, wordB);
+            }
+        }
+        return writer.Finish();
+    }
+
+private:
+    // Appends non-zero words in increasing index order and groups adjacent ones into blocks.
+    struct Writer {
+        explicit Writer(const size_t wordCount) : WordCount(wordCount)
+        {
+            PutVarint(Bytes, wordCount);
+        }
+
+        void Append(const size_t index, const uint64_t word)
+        {
+            if (Pending.empty() || index != PendingStart + Pending.size()) {
+                Flush();
+                PendingStart = index;
+            }
+            Pending.push_back(word);
+        }
+
+        BitmapDelta Finish()
+        {
+            Flush();
+            BitmapDelta delta;
+            delta.Bytes = std::move(Bytes);
+            delta.WordCount = WordCount;
+            return delta;
+        }
+
+        void Flush()
+        {
+            if (Pending.empty()) {
+                return;
+            }
+            PutVarint(Bytes, PendingStart - NextIndex);
+            PutVarint(Bytes, Pending.size());
+            const size_t offset = Bytes.size();
+            Bytes.resize(offset + Pending.size() * sizeof(uint64_t));
+            for (size_t i = 0; i < Pending.size(); ++i) {
+                StoreWord(Bytes.data() + offset + i * sizeof(uint64_t), Pending[i]);
+            }
+            NextIndex = PendingStart + Pending.size();
+            Pending.clear();
+        }
+
+        std::vector<uint8_t> Bytes;
+        size_t WordCount;
+        std::vector<uint64_t> Pending;
+        size_t PendingStart = 0;
+        size_t NextIndex = 0;
+    };
+
+    // Streams the (index, word) pairs of a delta in increasing index order.
+    struct Reader {
+        explicit Reader(const BitmapDelta& delta)
+            : Data(delta.Bytes.data()), End(delta.Bytes.data() + delta.Bytes.size()), WordCount(delta.WordCount)
+        {
+            if (Data != End && GetVarint() != delta.WordCount) {
+                throw std::runtime_error("BitmapDelta header does not match its word count");
+            }
+        }
+
+        bool Next(size_t& index, uint64_t& word)
+        {
+            if (Remaining == 0) {
+                if (Data == End) {
+                    return false;
+                }
+                // Deltas arrive from other nodes: every block must stay inside the bitmap.
+                const uint64_t gap = GetVarint();
+                if (gap > WordCount - Index) {
+                    throw std::runtime_error("BitmapDelta block starts past the end of the bitmap");
+                }
+                Index += static_cast<size_t>(gap);
+                const uint64_t remaining = GetVarint();
+                if (remaining == 0 || remaining > WordCount - Index) {
+                    throw std::runtime_error("BitmapDelta block runs past the end of the bitmap");
+                }
+                Remaining = static_cast<size_t>(remaining);
+                if (Remaining > static_cast<size_t>(End - Data) / sizeof(uint64_t)) {
+                    throw std::runtime_error("BitmapDelta block is truncated");
+                }
+            }
+            index = Index++;
+            word = LoadWord(Data);
+            Data += sizeof(uint64_t);
+            --Remaining;
+            return true;
+        }
+
+        uint64_t GetVarint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (Data == End) {
+                    throw std::runtime_error("BitmapDelta varint is truncated");
+                }
+                const uint8_t byte = *Data++;
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            throw std::runtime_error("BitmapDelta varint is too long");
+        }
+
+        const uint8_t* Data;
+        const uint8_t* End;
+        size_t WordCount;
+        size_t Index = 0;
+        size_t Remaining = 0;
+    };
+
+    static void PutVarint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    // Words are stored little endian so encoded deltas can be exchanged between hosts.
+    static void StoreWord(uint8_t* out, const uint64_t word)
+    {
+        for (int i = 0; i < 8; ++i) {
+            out[i] = static_cast<uint8_t>(word >> (8 * i));
+        }
+    }
+
+    static uint64_t LoadWord(const uint8_t* in)
+    {
+        uint64_t word = 0;
+        for (int i = 0; i < 8; ++i) {
+            word |= static_cast<uint64_t>(in[i]) << (8 * i);
+        }
+        return word;
+    }
+};
+
+// Reduce deltas to one by combining pairs level by level; each level's pairs run in parallel.
+inline BitmapDelta ReduceDeltas(std::vector<BitmapDelta> deltas, const DeltaMerge mode)
+{
+    if (deltas.empty()) {
+        throw std::invalid_argument("ReduceDeltas needs at least one delta");
+    }
+    while (deltas.size() > 1) {
+        const size_t pairs = deltas.size() / 2;
+        std::vector<BitmapDelta> next(pairs + deltas.size() % 2);
+        ParallelChunks(pairs, WorkerCount(), [&](unsigned, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                next[i] = BitmapDelta::Combine(deltas[2 * i], deltas[2 * i + 1], mode);
+            }
+        });
+        if (deltas.size() % 2 != 0) {
+            next.back() = std::move(deltas.back());
+        }
+        deltas.swap(next);
+    }
+    return std::move(deltas.front());
+}
@@ -2,270 +2,38 @@
 #include <type_traits>
 #include <iostream>
 #include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bitmask.h"
+#include "AdaptiveBitmap.h"
+#include "BandedBitMask.h"
+#include "BitImage.h"
+#include "BitMatrix.h"
+#include "BitmapCube.h"
+#include "BitmapDelta.h"
+#include "BuddyAllocator.h"
+#include "CountedBitMask.h"
+#include "DataflowSolver.h"
+#include "GraphColoring.h"
+#include "Hamt.h"
+#include "HybridMask.h"
+#include "LifeGrid.h"
+#include "LoudsTrie.h"
+#include "MaxClique.h"
+#include "OpTrace.h"
+#include "PrefixPopcount.h"
+#include "SeenSet.h"
+#include "SparseArray.h"
+#include "SignatureFile.h"
+#include "SharedMemoryBitmap.h"
+#include "TopK.h"
+#include "TriangleCounting.h"
+#include "WaveletMatrix.h"
 
 using namespace std;
 
-
-/*
-Constructors:
--Default constructor initializes the bitmask to zero.
--Copy constructor for creating a new bitmask from an existing one.
--Explicit constructor for initializing the bitmask with an initial value.
--Variadic template constructor for setting bits during initialization.
--ResetAllBits method to reset all bits to zero.
-
-Bit Manipulation :
--SetBit method for setting a specific bit.
--ClearBit method for clearing a specific bit.
--ClearBits method for clearing multiple bits.
--ToggleBit method for toggling a specific bit.
-
-Query and Information:
--Methods to check if a specific bit is set(IsBitSet) and if any bit is set(AnyBitSet).
--CountSetBits method to count the number of set bits.
--IsBitNSet method to check if a specific number of bits are set.
--AllBitsSet method to check if all bits are set.
--IsAnyBitSetInRange method to check if any bit in the current bitmask is set in another bitmask.
--toBinaryString method to obtain a binary string representation of the bitmask.
-
-Bitwise Operations :
--Overloaded operators for bitwise OR(| ), AND(&), XOR(^), addition(+), subtraction(-), left shift(<< ), and right shift(>> ).
--Compound assignment operators for in - place modifications(+=, -=, ^=).
--Comparison operators(== and != ) for comparing bitmasks.
--Assignment operator ( = ) for assigning one bitmask to another.
-
-Explicit Constructor :
--The constructor with an initial value is marked as explicit to prevent implicit conversions.
-
-Specialized Template :
--The Enummask template is introduced to specialize BitMask for use with enumerations.
-*/
-
-
-
-// A base template class for common bit manipulation functionality.
-template <typename MaskType, typename OpType, int TMax>
-struct BitMaskBase {
-    // Helper function to check if a bit position is valid.
-    static constexpr bool IsBitValidPos(const int pos)
-    {
-        return pos >= 0 && pos <= TMax;
-    }
-
-    // Ensure that TMax is within the allowed bits in MaskType.
-    static_assert(IsBitValidPos(TMax), "TMax shouldnt be above the allowed bits in MaskType");
-
-
-    // Constructors and Initialization:
-
-
-    // Default constructor initializes the BitMaskBase to zero.
-    BitMaskBase() : Mask(0) {};
-
-    // Copy constructor for creating a new BitMaskBase from an existing one.
-    BitMaskBase(const BitMaskBase& other) : Mask(other.Mask) {}
-
-    // Explicit constructor for initializing the BitMaskBase with an initial value.
-    explicit BitMaskBase(MaskType initialValue) : Mask(initialValue) {}
-
-    // Variadic template constructor for setting bits during compile time.
-    template<typename...Args>
-    constexpr BitMaskBase(const Args&...bits) : Mask(0)
-    {
-        (SetBits(static_cast<OpType>(bits)), ...);
-    }
-
-
-    // Bit Manipulation Functions:
-
-
-    // Set a specific bit at position bitPos.
-    template<typename...Args>
-    void SetBits(const Args&... bits)
-    {
-        (SetBit(static_cast<OpType>(bits)), ...);
-    }
-
-    // Clear a specific bit at position bitPos.
-    void SetBit(const OpType bitPos)
-    {
-        Mask |= (MaskType(1) << static_cast<MaskType>(bitPos));
-    }
-
-    // Clear mutliple bits.
-    template <typename... Args>
-    void ClearBits(const Args&... args) {
-        (clearBit(args ...));
-    }
-
-    // Clear a specific bit at position bitPos.
-    void ClearBit(const OpType bitPos)
-    {
-        Mask &= ~(MaskType(1) << static_cast<MaskType>(bitPos));
-    }
-
-    // Reset all bits to zero.
-    void ResetAllBits() {
-        Mask = 0;
-    }
-
-    // Toggle a specific bit at position bitPos.
-    void ToggleBit(const OpType bitPos)
-    {
-        Mask ^= (MaskType(1) << static_cast<MaskType>(bitPos));
-    }
-
-    // Check if a specific bit at position pos is set.
-    bool IsBitSet(const OpType pos) const {
-        return (Mask & (MaskType(1) << static_cast<MaskType>(pos))) != 0;
-    }
-
-    // Check if any bit is set in the BitMaskBase.
-    bool AnyBitSet() const {
-        return Mask != 0;
-    }
-
-    // Check if any bit in the current BitMaskBase is set in another BitMaskBase.
-    bool IsAnyBitSetInRange(BitMaskBase otherMask) const {
-        return (Mask & otherMask) != 0;
-    }
-
-    // Check if all bits in the BitMaskBase are set.
-    bool AllBitsSet() const {
-        return Mask == std::numeric_limits<MaskType>::max();
-    }
-
-    // Count the number of set bits in the BitMaskBase.
-    int CountSetBits() const {
-        int count = 0;
-        MaskType tempMask = Mask;
-        while (tempMask != 0) {
-            count += tempMask & 1;
-            tempMask >>= 1;
-        }
-        return count;
-    }
-
-    // Check if a specific number of bits are set.
-    OpType IsBitNSet(int pos) const {
-        int count = 0;
-        MaskType tempMask = Mask;
-        while (tempMask != 0 && count < pos) {
-            count += tempMask & 1;
-            tempMask >>= 1;
-        }
-        return static_cast<OpType>(count);
-    }
-
-    // Convert the BitMaskBase to a binary string representation.
-    std::string toBinaryString() const {
-        std::string result;
-        MaskType value = Mask;
-
-        for (int i = TMax - 1; i >= 0; i--) {
-            result += ((value >> i) & 1) ? '1' : '0';
-        }
-
-        return result;
-    }
-
-    // Bitwise Operations:
-
-    BitMaskBase operator+(const BitMaskBase& other) const {
-        BitMaskBase result;
-        result.Mask = Mask | other.Mask;
-        return result;
-    }
-
-    BitMaskBase operator-(const BitMaskBase& other) const {
-        BitMaskBase result;
-        result.Mask = Mask & (~other.Mask);
-        return result;
-    }
-
-    BitMaskBase& operator+=(const BitMaskBase& other) {
-        Mask |= other.Mask;
-        return *this;
-    }
-
-    BitMaskBase& operator-=(const BitMaskBase& other) {
-        Mask &= (~other.Mask);
-        return *this;
-    }
-
-    BitMaskBase operator^(const BitMaskBase& other) const {
-        BitMaskBase result;
-        result.Mask = Mask ^ other.Mask;
-        return result;
-    }
-
-    BitMaskBase& operator^=(const BitMaskBase& other) {
-        Mask ^= other.Mask;
-        return *this;
-    }
-
-    BitMaskBase operator~() const {
-        BitMaskBase result(*this);
-        result.Mask = ~result.Mask;
-        return result;
-    }
-
-    BitMaskBase operator<<(int shift) const {
-        BitMaskBase result(*this);
-        result.Mask <<= shift;
-        return result;
-    }
-
-    BitMaskBase operator>>(int shift) const {
-        BitMaskBase result(*this);
-        result.Mask >>= shift;
-        return result;
-    }
-
-    BitMaskBase& operator<<=(int shift) {
-        Mask <<= shift;
-        return *this;
-    }
-
-    BitMaskBase& operator>>=(int shift) {
-        Mask >>= shift;
-        return *this;
-    }
-
-    bool operator==(const BitMaskBase& other) const {
-        return Mask == other.Mask;
-    }
-
-    bool operator!=(const BitMaskBase& other) const {
-        return Mask != other.Mask;
-    }
-
-    BitMaskBase& operator=(const BitMaskBase& other) {
-        Mask = other.Mask;
-        return *this;
-    }
-
-    MaskType Mask;
-};
-
-// A template class for creating and manipulating numerical bit masks.
-template <typename MaskType, typename OpType = MaskType, int TMax = (sizeof(MaskType) * 8)>
-struct BitMask : public BitMaskBase<MaskType, OpType, TMax> 
-{
-    using BitMaskBase<MaskType, OpType, TMax>::BitMaskBase; // Inherit constructors from BitMaskBase.
-    BitMask(const BitMaskBase<MaskType, OpType, TMax>& other) : BitMaskBase<MaskType, OpType, TMax>(other) {}
-};
-
-
-// Specialized template for using enumerations as masks.
-template <typename TEnum, typename MaskType = int>
-struct Enummask : BitMaskBase<MaskType, TEnum, static_cast<int>(TEnum::MAX)>
-{
-    using BitMaskBase<MaskType, TEnum, static_cast<int>(TEnum::MAX)>::BitMaskBase; // Inherit constructors from BitMask.
-    Enummask(const BitMaskBase<MaskType, TEnum, static_cast<int>(TEnum::MAX)>& other)
-        : BitMaskBase<MaskType, TEnum, static_cast<int>(TEnum::MAX)>(other) {}
-};
-
 enum class MyEnum {
     Value1,
     Value2,
@@ -281,9 +49,21 @@ int main() {
     bitmask.SetBit(2);  // Sets the 2nd bit to 1.
     bitmask.SetBit(5);  // Sets the 5th bit to 1.
 
-    //#todo_khaled can we check for overflow dynamically
     std::cout << "BitMask 1: " << bitmask.toBinaryString() << std::endl;
 
+    // Out of range positions can be checked dynamically through the CheckPolicy parameter.
+    BitMask<uint8_t, uint8_t, 8, BitCheck::Throw> checkedMask;
+    try {
+        checkedMask.SetBit(9);
+    }
+    catch (const std::out_of_range& error) {
+        std::cout << "Checked BitMask rejected bit 9: " << error.what() << std::endl;
+    }
+
+    BitMask<uint8_t, uint8_t, 8, BitCheck::Saturate> saturatedMask;
+    saturatedMask.SetBit(9);  // Ignored, the bit lies past the end of the mask.
+    std::cout << "Saturated BitMask: " << saturatedMask.toBinaryString() << std::endl;
+
     //0b1010 will be converted to Typemask
 
     // Using variadic template constructor.
@@ -303,6 +83,13 @@ int main() {
     bitmask.ClearBit(2);  // Clears the 2nd bit (sets it to 0).
     std::cout << "Cleared BitMask 1: " << bitmask.toBinaryString() << std::endl;
 
+    // Multiple bits are folded into one mask and applied with a single operation.
+    BitMask<uint16_t> foldedMask;
+    foldedMask.SetBits(0, 4, 9);      // One OR.
+    foldedMask.ClearBits(4);          // One AND-NOT.
+    foldedMask.ToggleBits<1, 9>();    // One XOR with a compile time constant.
+    std::cout << "Folded BitMask: " << foldedMask.toBinaryString() << std::endl;
+
     bool anyBitSet = bitmask.AnyBitSet();  // Checks if any bit is set.
     std::cout << "Any bit set in BitMask 1? " << std::boolalpha << anyBitSet << std::endl;
 
@@ -343,5 +130,244 @@ int main() {
     BitMask<uint16_t> bitmaskVarint(MyEnum::Value1, MyEnum::Value2); // Sets bits for Value1 and Value2.
     std::cout << "bitmaskVarint: " << bitmaskVarint.toBinaryString() << std::endl;
 
+    // Prefix popcount offsets and compaction over an array of masks.
+    std::vector<BitMask<uint8_t>> selection = { BitMask<uint8_t>(0, 2), BitMask<uint8_t>(), BitMask<uint8_t>(7) };
+    std::vector<size_t> offsets = PrefixPopcount(selection);
+    std::cout << "Compaction offsets: " << offsets[0] << " " << offsets[1] << " " << offsets[2] << std::endl;
+
+    std::vector<int> values(24);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<int>(i * 10);
+    }
+    std::vector<int> compacted = CompactByMask(values, selection);
+    std::cout << "Compacted values:";
+    for (int value : compacted) {
+        std::cout << " " << value;
+    }
+    std::cout << std::endl;
+
+    // Hybrid sparse/dense mask over a 4096-bit universe.
+    HybridMask<4096> sparseMask(8, 700, 4000);
+    HybridMask<4096> denseMask;
+    for (int bit = 0; bit < 64; bit += 4) {
+        denseMask.SetBit(bit);
+    }
+    std::cout << "Hybrid masks: " << sparseMask.CountSetBits() << " bits sparse=" << !sparseMask.IsDense()
+        << ", " << denseMask.CountSetBits() << " bits dense=" << denseMask.IsDense()
+        << ", intersection " << (sparseMask & denseMask).CountSetBits() << " bits" << std::endl;
+
+    // Exact deduplication of a stream of ids across partition workers.
+    {
+        SeenSet<uint64_t> seen(2, 1);
+        SeenSet<uint64_t>::Producer& producer = seen.GetProducer(0);
+        for (uint64_t id : { 42ull, 7ull, 42ull, 1ull << 63, 7ull }) {
+            producer.Insert(id);
+        }
+        seen.Finish();
+        std::cout << "SeenSet distinct ids: " << seen.Cardinality() << std::endl;
+    }
+
+#if defined(__linux__)
+    // Cross-process slot claiming through a shared memory bitmap.
+    {
+        SharedMemoryBitmap<>::Unlink("/bitmask_demo");
+        SharedMemoryBitmap<> slots = SharedMemoryBitmap<>::Create("/bitmask_demo", 128);
+        const uint64_t first = slots.ClaimFirstClear();
+        const uint64_t second = slots.ClaimFirstClear();
+        std::cout << "Claimed shared slots: " << first << " " << second << std::endl;
+        SharedMemoryBitmap<>::Unlink("/bitmask_demo");
+    }
+#endif
+
+    // Nodes send deltas against a shared base instead of whole bitmaps; the coordinator reduces them.
+    {
+        WideBitMask<4096> base(1, 2, 3);
+        std::vector<BitmapDelta> nodeDeltas;
+        for (int node = 0; node < 4; ++node) {
+            WideBitMask<4096> nodeMask = base;
+            nodeMask.SetBits(100 * node + 10, 3000 + node);
+            nodeDeltas.push_back(BitmapDelta::Encode(base, nodeMask));
+        }
+        BitmapDelta merged = ReduceDeltas(nodeDeltas, DeltaMerge::Or);
+        merged.ApplyTo(base);
+        std::cout << "Merged node deltas: " << merged.Bytes.size() << " bytes, " << base.CountSetBits() << " bits set" << std::endl;
+
+        // A corrupted delta whose block starts past the end of a two word bitmap is rejected.
+        BitmapDelta corrupted;
+        corrupted.WordCount = 2;
+        corrupted.Bytes = { 2, 100, 1, 0, 0, 0, 0, 0, 0, 0, 1 };
+        uint64_t target[2] = { 0, 0 };
+        try {
+            corrupted.ApplyTo(target, 2);
+        }
+        catch (const std::runtime_error& error) {
+            std::cout << "Corrupted delta rejected: " << error.what() << std::endl;
+        }
+    }
+
+    // Wide mask with a cached cardinality.
+    CountedBitMask<1024> countedMask(3, 500, 1000);
+    countedMask += CountedBitMask<1024>(500, 501);
+    std::cout << "Counted mask: " << countedMask.CountSetBits() << " bits, empty="
+        << !countedMask.AnyBitSet() << std::endl;
+
+    // Wide masks that only touch the words between their lowest and highest set bit.
+    BandedBitMask<1 << 16> bandA(40000, 40100);
+    BandedBitMask<1 << 16> bandB(40100, 40200);
+    bandA += bandB;
+    std::cout << "Banded mask: " << bandA.CountSetBits() << " bits in words " << bandA.FirstActiveWord()
+        << ".." << bandA.LastActiveWord() << std::endl;
+
+    AdaptiveBitmap<1 << 16> adaptive;
+    for (int i = 1000; i < 3000; ++i) {
+        adaptive.SetBit(i);
+    }
+    const char* adaptiveKinds[] = { "array", "dense", "runs" };
+    std::cout << "Adaptive bitmap: " << adaptive.CountSetBits() << " bits stored as "
+        << adaptiveKinds[static_cast<int>(adaptive.Representation())] << std::endl;
+
+    OpTrace trace;
+    TracedMask<WideBitMask<1024>> tracedA(trace);
+    TracedMask<WideBitMask<1024>> tracedB(trace);
+    for (int i = 0; i < 1000; ++i) {
+        tracedA.SetBit((i * 37) % 1024);
+        tracedB.ToggleBit((i * 11) % 1024);
+        if (i % 100 == 0) {
+            tracedA &= tracedB;
+            tracedA.CountSetBits();
+        }
+    }
+    const ReplayStats wideReplay = ReplayTrace<WideBitMask<1024>>(trace);
+    const ReplayStats countedReplay = ReplayTrace<CountedBitMask<1024>>(trace);
+    std::cout << "Trace replay: " << wideReplay.Operations << " ops in " << trace.Data().size() << " bytes, p99 "
+        << wideReplay.P99Nanoseconds << " ns, checksums " << (wideReplay.Checksum == countedReplay.Checksum ? "match" : "differ") << std::endl;
+
+    SignatureFile<256> signatures;
+    signatures.AddDocuments({ "bitmask operations", "bit slicing", "signature files", "prefix popcount", "wide masks" });
+    int signatureCandidates = 0;
+    signatures.ForEachCandidate("mask", [&](int) { ++signatureCandidates; });
+    std::cout << "Signature file: " << signatureCandidates << " of " << signatures.DocumentCount() << " documents may contain \"mask\"" << std::endl;
+
+    BitmapCube cube(1000);
+    const int regionDimension = cube.AddDimension(4);
+    const int planDimension = cube.AddDimension(3);
+    for (int row = 0; row < cube.RowCount(); ++row) {
+        cube.SetRowValue(regionDimension, row, row % 4);
+        cube.SetRowValue(planDimension, row, (row / 7) % 3);
+    }
+    const CubeCounts cells = cube.GroupBy({ regionDimension, planDimension });
+    std::cout << "Bitmap cube: region 2 / plan 1 has " << cells.Cell(2, 1) << " rows" << std::endl;
+
+    std::vector<BitMask<uint16_t>> candidates;
+    for (int i = 0; i < 100; ++i) {
+        candidates.emplace_back(static_cast<uint16_t>(i * 2654435761u >> 16));
+    }
+    const BitMask<uint16_t> required(static_cast<uint16_t>(0xF0F0));
+    const std::vector<RankedMask<int>> bestMatches = TopKByPopcount(candidates, required, 3);
+    std::vector<double> bitWeights(16, 1.0);
+    bitWeights[15] = 10.0;
+    const std::vector<RankedMask<double>> heaviest = TopKByWeight(candidates, bitWeights, 1);
+    std::cout << "Top-k: best match #" << bestMatches[0].Index << " shares " << bestMatches[0].Score
+        << " bits, heaviest #" << heaviest[0].Index << " scores " << heaviest[0].Score << std::endl;
+
+    HamtMap<int, std::string> versionOne;
+    HamtMap<int, std::string>::Transient batch = versionOne.ToTransient();
+    for (int i = 0; i < 100; ++i) {
+        batch.Set(i, "v" + std::to_string(i));
+    }
+    versionOne = batch.Persistent();
+    const HamtMap<int, std::string> versionTwo = versionOne.Insert(7, "changed").Erase(8);
+    std::cout << "HAMT: v1 has " << versionOne.Size() << " keys and 7 -> " << *versionOne.Find(7) << ", v2 has "
+        << versionTwo.Size() << " keys and 7 -> " << *versionTwo.Find(7) << std::endl;
+
+    BumpArena sparseArena;
+    SparseArray<double> sparse(1000000, &sparseArena);
+    for (size_t i = 0; i < 1000000; i += 997) {
+        sparse.Insert(i, static_cast<double>(i) / 2);
+    }
+    sparse.Erase(997);
+    std::cout << "Sparse array: " << sparse.Count() << " of " << sparse.Size() << " present in " << sparse.MemoryBytes()
+        << " bytes, [1994] = " << sparse.Get(1994) << ", [997] = " << sparse.Get(997, -1.0) << std::endl;
+
+    const LoudsTrie dictionary = LoudsTrie::Build({ "car", "card", "care", "cart", "cat", "dog" });
+    std::cout << "LOUDS trie: " << dictionary.KeyCount() << " keys in " << dictionary.NodeCount() << " nodes, completions of \"car\":";
+    dictionary.ForEachWithPrefix("car", [](const std::string& key, size_t) { std::cout << " " << key; });
+    std::cout << std::endl;
+
+    const WaveletMatrix<uint32_t> tokens({ 5, 2, 7, 2, 9, 2, 4, 7 });
+    std::cout << "Wavelet matrix: token 2 occurs " << tokens.Rank(2, tokens.Size()) << " times, third at " << tokens.Select(2, 2)
+        << ", median of [1, 7) is " << tokens.Quantile(1, 7, 3) << ", " << tokens.RangeFrequency(0, 8, 4, 8) << " tokens in [4, 8)" << std::endl;
+
+    std::vector<std::byte> buddyRegion(size_t(1) << 16);
+    BuddyAllocator buddy(buddyRegion.data(), buddyRegion.size());
+    void* small = buddy.Allocate(24);
+    void* large = buddy.Allocate(5000);
+    std::cout << "Buddy allocator: free orders " << buddy.FreeOrderMask().toBinaryString();
+    buddy.Deallocate(small, 24);
+    buddy.Deallocate(large, 5000);
+    std::cout << " while in use, largest free block " << buddy.LargestFreeBlock() << " of " << buddy.FreeBytes() << " free bytes after freeing" << std::endl;
+
+    // Liveness of variables a (0), b (1) and c (2) over entry -> loop <-> body, loop -> exit.
+    DataflowProblem<> liveness;
+    liveness.Direction = DataflowDirection::Backward;
+    liveness.Successors = { { 1 }, { 2, 3 }, { 1 }, {} };
+    liveness.Gen.assign(4, DynamicBitMask<>(3));
+    liveness.Kill.assign(4, DynamicBitMask<>(3));
+    liveness.Kill[0].SetBits(0, 1);
+    liveness.Gen[1].SetBit(0);
+    liveness.Gen[2].SetBits(0, 1);
+    liveness.Kill[2].SetBit(1);
+    liveness.Gen[3].SetBit(1);
+    const DataflowResult<> live = DataflowSolver<>::Solve(liveness);
+    std::cout << "Dataflow: live into loop " << live.In[1].toBinaryString() << ", live out of entry " << live.Out[0].toBinaryString()
+        << " after " << live.Evaluations << " transfers" << std::endl;
+
+    // Interference of five live ranges with two registers: the triangle 0-1-2 forces a spill.
+    const InterferenceGraph interference(5, { { 0, 1 }, { 1, 2 }, { 0, 2 }, { 2, 3 }, { 3, 4 } });
+    const ColoringResult registers = DSaturColoring(interference, 2);
+    std::cout << "Graph coloring: " << registers.ColorCount << " registers, " << registers.SpillCount << " spill, colors";
+    for (const int color : registers.Colors) {
+        std::cout << " " << color;
+    }
+    std::cout << std::endl;
+
+    // Two rings of three accounts sharing account 2, plus a four-account ring 4-5-6-7.
+    BitMatrix transfers(8);
+    for (const auto& [a, b] : std::vector<std::pair<int, int>>{ { 0, 1 }, { 1, 2 }, { 0, 2 }, { 2, 3 }, { 3, 4 }, { 2, 4 },
+        { 4, 5 }, { 4, 6 }, { 4, 7 }, { 5, 6 }, { 5, 7 }, { 6, 7 } }) {
+        transfers.AddEdge(a, b);
+    }
+    const MaxCliqueResult ring = MaxCliqueSolver::Solve(transfers);
+    std::cout << "Max clique:";
+    for (const int v : ring.Clique) {
+        std::cout << " " << v;
+    }
+    std::cout << " after " << ring.Nodes << " search nodes" << std::endl;
+
+    // A wheel: hub 0 joined to the ring 1-2-3-4-5-1 closes five triangles; hubs from degree 4.
+    const TriangleGraph wheel(6, { { 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 }, { 0, 5 }, { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 5 }, { 5, 1 } }, 4);
+    std::cout << "Triangles: " << wheel.CountTriangles() << " with " << wheel.HubCount() << " hub, 1 and 3 share "
+        << wheel.CommonNeighbors(1, 3) << " neighbors" << std::endl;
+
+    // A glider moves one cell diagonally every four generations.
+    LifeGrid life(8, 8);
+    for (const auto& [x, y] : std::vector<std::pair<int, int>>{ { 1, 0 }, { 2, 1 }, { 0, 2 }, { 1, 2 }, { 2, 2 } }) {
+        life.SetCell(x, y);
+    }
+    life.Step(4);
+    std::cout << "Life: generation " << life.Generation() << ", population " << life.Population() << ", row 3 "
+        << life.Row(3).toBinaryString() << std::endl;
+
+    // Closing a 3 x 3 square fills the one pixel hole in a 4 x 3 block.
+    BitImage blob(10, 7);
+    for (int y = 2; y <= 4; ++y) {
+        for (int x = 3; x <= 6; ++x) {
+            blob.SetPixel(x, y, !(x == 4 && y == 3));
+        }
+    }
+    const BitImage closed = blob.Close(StructuringElement::Rectangle(3, 3));
+    std::cout << "Morphology: " << blob.CountSetPixels() << " pixels closed to " << closed.CountSetPixels()
+        << ", eroded to " << closed.Erode(StructuringElement::Cross(3, 3)).CountSetPixels() << std::endl;
+
     return 0;
 }
\ No newline at end of file
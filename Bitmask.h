@@ -0,0 +1,427 @@
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+/*
+Constructors:
+-Default constructor initializes the bitmask to zero.
+-Copy constructor for creating a new bitmask from an existing one.
+-Explicit constructor for initializing the bitmask with an initial value.
+-Variadic template constructor for setting bits during initialization.
+-ResetAllBits method to reset all bits to zero.
+
+Bit Manipulation :
+-SetBit method for setting a specific bit.
+-ClearBit method for clearing a specific bit.
+-ClearBits method for clearing multiple bits.
+-ToggleBit method for toggling a specific bit.
+-SetBits, ClearBits and ToggleBits fold all positions into one mask and apply it with a single
+ OR, AND-NOT or XOR. The SetBits<1, 4>() forms take compile time positions and fold to a constant.
+
+Query and Information:
+-Methods to check if a specific bit is set(IsBitSet) and if any bit is set(AnyBitSet).
+-CountSetBits method to count the number of set bits.
+-CountSetBitsBelow method to count the set bits below a position (the rank of that position), which
+ is the index of its slot in a popcount-compacted array; positions past the width count every bit.
+-IsBitNSet method to check if a specific number of bits are set.
+-AllBitsSet method to check if all bits are set.
+-IsAnyBitSetInRange method to check if any bit in the current bitmask is set in another bitmask.
+-toBinaryString method to obtain a binary string representation of the bitmask.
+
+Bitwise Operations :
+-Overloaded operators for bitwise OR(| ), AND(&), XOR(^), addition(+), subtraction(-), left shift(<< ), and right shift(>> ).
+-Compound assignment operators for in - place modifications(+=, -=, ^=).
+-Comparison operators(== and != ) for comparing bitmasks.
+-Assignment operator ( = ) for assigning one bitmask to another.
+
+Explicit Constructor :
+-The constructor with an initial value is marked as explicit to prevent implicit conversions.
+
+Specialized Template :
+-The Enummask template is introduced to specialize BitMask for use with enumerations.
+
+Bounds Checking :
+-The CheckPolicy template parameter decides what happens when a bit position is outside [0, TMax).
+-BitCheck::Unchecked (the default) shifts unconditionally and compiles to the same code as an unchecked mask.
+-BitCheck::Assert asserts in debug builds, BitCheck::Throw throws std::out_of_range and
+ BitCheck::Saturate turns the operation into a no-op (IsBitSet returns false).
+-Define BITMASK_CHECK_POLICY (e.g. BitCheck::Assert) to change the default for a whole build.
+*/
+
+
+// Bounds checking policies for bit positions.
+namespace BitCheck {
+    // Check pos against [0, limit) in the position's own type, before any narrowing, so 64-bit
+    // positions such as 2^32 + 3 are not truncated into range. limit is never negative.
+    template <typename Pos, typename Limit>
+    constexpr bool InRange(const Pos pos, const Limit limit)
+    {
+        if constexpr (std::is_signed_v<Pos>) {
+            if (pos < 0) {
+                return false;
+            }
+        }
+        return static_cast<uint64_t>(pos) < static_cast<uint64_t>(limit);
+    }
+
+    // No checking; out of range positions are undefined behavior, exactly like a raw shift.
+    struct Unchecked {
+        template <typename Pos, typename Limit>
+        static constexpr bool Validate(const Pos, const Limit) { return true; }
+    };
+
+    // Assert the position is in range; free in builds with NDEBUG.
+    struct Assert {
+        template <typename Pos, typename Limit>
+        static constexpr bool Validate([[maybe_unused]] const Pos pos, [[maybe_unused]] const Limit limit)
+        {
+            assert(InRange(pos, limit) && "bit position out of range");
+            return true;
+        }
+    };
+
+    // Throw std::out_of_range for positions outside the mask.
+    struct Throw {
+        template <typename Pos, typename Limit>
+        static constexpr bool Validate(const Pos pos, const Limit limit)
+        {
+            if (!InRange(pos, limit)) {
+                throw std::out_of_range("bit position " + std::to_string(pos) + " is outside the mask");
+            }
+            return true;
+        }
+    };
+
+    // Ignore out of range positions, as if the bit lived past the end of the mask.
+    struct Saturate {
+        template <typename Pos, typename Limit>
+        static constexpr bool Validate(const Pos pos, const Limit limit)
+        {
+            return InRange(pos, limit);
+        }
+    };
+}
+
+#ifdef BITMASK_CHECK_POLICY
+using DefaultCheckPolicy = BITMASK_CHECK_POLICY;
+#else
+using DefaultCheckPolicy = BitCheck::Unchecked;
+#endif
+
+
+
+// A base template class for common bit manipulation functionality.
+template <typename MaskType, typename OpType, int TMax, typename CheckPolicy = DefaultCheckPolicy>
+struct BitMaskBase {
+    // Helper function to check if a bit position is valid.
+    static constexpr bool IsBitValidPos(const int pos)
+    {
+        return pos >= 0 && pos <= TMax;
+    }
+
+    // Ensure that TMax is within the allowed bits in MaskType.
+    static_assert(IsBitValidPos(TMax), "TMax shouldnt be above the allowed bits in MaskType");
+
+    // Run CheckPolicy on bitPos; false means the operation should be skipped.
+    static constexpr bool IsBitInRange(const OpType bitPos)
+    {
+        if constexpr (std::is_enum_v<OpType>) {
+            return CheckPolicy::Validate(static_cast<std::underlying_type_t<OpType>>(bitPos), TMax);
+        }
+        else {
+            return CheckPolicy::Validate(bitPos, TMax);
+        }
+    }
+
+    // Single bit mask for bitPos, or zero when CheckPolicy rejects the position.
+    static constexpr MaskType BitOf(const OpType bitPos)
+    {
+        return IsBitInRange(bitPos) ? MaskType(MaskType(1) << static_cast<MaskType>(bitPos)) : MaskType(0);
+    }
+
+    // Combined mask of every position in bits, folded with OR.
+    template<typename...Args>
+    static constexpr MaskType BitsOf(const Args&... bits)
+    {
+        return static_cast<MaskType>((MaskType(0) | ... | BitOf(static_cast<OpType>(bits))));
+    }
+
+    // Combined mask of every position in bits, folded with XOR so repeated positions cancel out
+    // exactly like repeated ToggleBit calls.
+    template<typename...Args>
+    static constexpr MaskType ToggledBitsOf(const Args&... bits)
+    {
+        return static_cast<MaskType>((MaskType(0) ^ ... ^ BitOf(static_cast<OpType>(bits))));
+    }
+
+    // Combined mask of compile time positions; out of range positions fail to compile.
+    template<auto...Bits>
+    static constexpr MaskType ConstBits = [] {
+        static_assert(((static_cast<int>(Bits) >= 0 && static_cast<int>(Bits) < TMax) && ...), "bit position out of range");
+        return static_cast<MaskType>((MaskType(0) | ... | MaskType(MaskType(1) << static_cast<MaskType>(Bits))));
+    }();
+
+    // XOR folded counterpart of ConstBits for ToggleBits.
+    template<auto...Bits>
+    static constexpr MaskType ConstToggledBits = [] {
+        static_assert(((static_cast<int>(Bits) >= 0 && static_cast<int>(Bits) < TMax) && ...), "bit position out of range");
+        return static_cast<MaskType>((MaskType(0) ^ ... ^ MaskType(MaskType(1) << static_cast<MaskType>(Bits))));
+    }();
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor initializes the BitMaskBase to zero.
+    BitMaskBase() : Mask(0) {};
+
+    // Copy constructor for creating a new BitMaskBase from an existing one.
+    BitMaskBase(const BitMaskBase& other) : Mask(other.Mask) {}
+
+    // Explicit constructor for initializing the BitMaskBase with an initial value.
+    explicit BitMaskBase(MaskType initialValue) : Mask(initialValue) {}
+
+    // Variadic template constructor for setting bits during compile time.
+    template<typename...Args>
+    constexpr BitMaskBase(const Args&...bits) : Mask(BitsOf(bits...)) {}
+
+
+    // Bit Manipulation Functions:
+
+
+    // Set multiple bits with a single OR of their combined mask.
+    template<typename...Args>
+    void SetBits(const Args&... bits)
+    {
+        Mask |= BitsOf(bits...);
+    }
+
+    // Set multiple compile time bits, e.g. SetBits<1, 4>(); the mask is a constant.
+    template<auto...Bits>
+    void SetBits()
+    {
+        Mask |= ConstBits<Bits...>;
+    }
+
+    // Clear a specific bit at position bitPos.
+    void SetBit(const OpType bitPos)
+    {
+        if (IsBitInRange(bitPos)) {
+            Mask |= (MaskType(1) << static_cast<MaskType>(bitPos));
+        }
+    }
+
+    // Clear multiple bits with a single AND-NOT of their combined mask.
+    template <typename... Args>
+    void ClearBits(const Args&... args) {
+        Mask &= ~BitsOf(args...);
+    }
+
+    // Clear multiple compile time bits, e.g. ClearBits<1, 4>(); the mask is a constant.
+    template<auto...Bits>
+    void ClearBits() {
+        Mask &= ~ConstBits<Bits...>;
+    }
+
+    // Clear a specific bit at position bitPos.
+    void ClearBit(const OpType bitPos)
+    {
+        if (IsBitInRange(bitPos)) {
+            Mask &= ~(MaskType(1) << static_cast<MaskType>(bitPos));
+        }
+    }
+
+    // Reset all bits to zero.
+    void ResetAllBits() {
+        Mask = 0;
+    }
+
+    // Toggle a specific bit at position bitPos.
+    void ToggleBit(const OpType bitPos)
+    {
+        if (IsBitInRange(bitPos)) {
+            Mask ^= (MaskType(1) << static_cast<MaskType>(bitPos));
+        }
+    }
+
+    // Toggle multiple bits with a single XOR of their combined mask.
+    template <typename... Args>
+    void ToggleBits(const Args&... args) {
+        Mask ^= ToggledBitsOf(args...);
+    }
+
+    // Toggle multiple compile time bits, e.g. ToggleBits<1, 4>(); the mask is a constant.
+    template<auto...Bits>
+    void ToggleBits() {
+        Mask ^= ConstToggledBits<Bits...>;
+    }
+
+    // Check if a specific bit at position pos is set.
+    bool IsBitSet(const OpType pos) const {
+        return IsBitInRange(pos) && (Mask & (MaskType(1) << static_cast<MaskType>(pos))) != 0;
+    }
+
+    // Check if any bit is set in the BitMaskBase.
+    bool AnyBitSet() const {
+        return Mask != 0;
+    }
+
+    // Check if any bit in the current BitMaskBase is set in another BitMaskBase.
+    bool IsAnyBitSetInRange(BitMaskBase otherMask) const {
+        return (Mask & otherMask) != 0;
+    }
+
+    // Check if all bits in the BitMaskBase are set.
+    bool AllBitsSet() const {
+        return Mask == std::numeric_limits<MaskType>::max();
+    }
+
+    // Count the number of set bits in the BitMaskBase.
+    int CountSetBits() const {
+        return std::popcount(static_cast<std::make_unsigned_t<MaskType>>(Mask));
+    }
+
+    // Count the set bits below position pos with one masked popcount. Any pos is accepted: positions
+    // at or past the width of MaskType count every set bit and negative ones count none.
+    int CountSetBitsBelow(const OpType pos) const {
+        using Unsigned = std::make_unsigned_t<MaskType>;
+        using Raw = typename std::conditional_t<std::is_enum_v<OpType>, std::underlying_type<OpType>, std::type_identity<OpType>>::type;
+        const Raw raw = static_cast<Raw>(pos);
+        if constexpr (std::is_signed_v<Raw>) {
+            if (raw < 0) {
+                return 0;
+            }
+        }
+        // Shifting by the full width is undefined, so the whole mask is counted instead.
+        if (static_cast<uint64_t>(raw) >= static_cast<uint64_t>(std::numeric_limits<Unsigned>::digits)) {
+            return CountSetBits();
+        }
+        const Unsigned below = static_cast<Unsigned>((Unsigned(1) << static_cast<int>(raw)) - 1);
+        return std::popcount(static_cast<Unsigned>(static_cast<Unsigned>(Mask) & below));
+    }
+
+    // Check if a specific number of bits are set.
+    OpType IsBitNSet(int pos) const {
+        int count = 0;
+        MaskType tempMask = Mask;
+        while (tempMask != 0 && count < pos) {
+            count += tempMask & 1;
+            tempMask >>= 1;
+        }
+        return static_cast<OpType>(count);
+    }
+
+    // Convert the BitMaskBase to a binary string representation.
+    std::string toBinaryString() const {
+        std::string result;
+        MaskType value = Mask;
+
+        for (int i = TMax - 1; i >= 0; i--) {
+            result += ((value >> i) & 1) ? '1' : '0';
+        }
+
+        return result;
+    }
+
+    // Bitwise Operations:
+
+    BitMaskBase operator+(const BitMaskBase& other) const {
+        BitMaskBase result;
+        result.Mask = Mask | other.Mask;
+        return result;
+    }
+
+    BitMaskBase operator-(const BitMaskBase& other) const {
+        BitMaskBase result;
+        result.Mask = Mask & (~other.Mask);
+        return result;
+    }
+
+    BitMaskBase& operator+=(const BitMaskBase& other) {
+        Mask |= other.Mask;
+        return *this;
+    }
+
+    BitMaskBase& operator-=(const BitMaskBase& other) {
+        Mask &= (~other.Mask);
+        return *this;
+    }
+
+    BitMaskBase operator^(const BitMaskBase& other) const {
+        BitMaskBase result;
+        result.Mask = Mask ^ other.Mask;
+        return result;
+    }
+
+    BitMaskBase& operator^=(const BitMaskBase& other) {
+        Mask ^= other.Mask;
+        return *this;
+    }
+
+    BitMaskBase operator~() const {
+        BitMaskBase result(*this);
+        result.Mask = ~result.Mask;
+        return result;
+    }
+
+    BitMaskBase operator<<(int shift) const {
+        BitMaskBase result(*this);
+        result.Mask <<= shift;
+        return result;
+    }
+
+    BitMaskBase operator>>(int shift) const {
+        BitMaskBase result(*this);
+        result.Mask >>= shift;
+        return result;
+    }
+
+    BitMaskBase& operator<<=(int shift) {
+        Mask <<= shift;
+        return *this;
+    }
+
+    BitMaskBase& operator>>=(int shift) {
+        Mask >>= shift;
+        return *this;
+    }
+
+    bool operator==(const BitMaskBase& other) const {
+        return Mask == other.Mask;
+    }
+
+    bool operator!=(const BitMaskBase& other) const {
+        return Mask != other.Mask;
+    }
+
+    BitMaskBase& operator=(const BitMaskBase& other) {
+        Mask = other.Mask;
+        return *this;
+    }
+
+    MaskType Mask;
+};
+
+// A template class for creating and manipulating numerical bit masks.
+template <typename MaskType, typename OpType = MaskType, int TMax = (sizeof(MaskType) * 8), typename CheckPolicy = DefaultCheckPolicy>
+struct BitMask : public BitMaskBase<MaskType, OpType, TMax, CheckPolicy> 
+{
+    using BitMaskBase<MaskType, OpType, TMax, CheckPolicy>::BitMaskBase; // Inherit constructors from BitMaskBase.
+    BitMask(const BitMaskBase<MaskType, OpType, TMax, CheckPolicy>& other) : BitMaskBase<MaskType, OpType, TMax, CheckPolicy>(other) {}
+};
+
+
+// Specialized template for using enumerations as masks.
+template <typename TEnum, typename MaskType = int, typename CheckPolicy = DefaultCheckPolicy>
+struct Enummask : BitMaskBase<MaskType, TEnum, static_cast<int>(TEnum::MAX), CheckPolicy>
+{
+    using BitMaskBase<MaskType, TEnum, static_cast<int>(TEnum::MAX), CheckPolicy>::BitMaskBase; // Inherit constructors from BitMask.
+    Enummask(const BitMaskBase<MaskType, TEnum, static_cast<int>(TEnum::MAX), CheckPolicy>& other)
+        : BitMaskBase<MaskType, TEnum, static_cast<int>(TEnum::MAX), CheckPolicy>(other) {}
+};
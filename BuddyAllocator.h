@@ -0,0 +1,458 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bitmask.h"
+#include "WordKernels.h"
+
+/*
+BuddyAllocator is a binary buddy allocator over a caller-provided memory region.
+
+-Blocks are MinBlock << order bytes. Free blocks of each order sit on an intrusive doubly linked list,
+ and a BitMask<uint32_t> flags the orders whose list is non-empty, so the smallest order that can
+ serve a request is one countr_zero of that mask shifted past the requested order.
+-A pair bitmap holds, for every buddy pair of every order, whether exactly one of the two is free
+ (the XOR of their free states). Freeing a block toggles its pair bit: a clear bit after the toggle
+ means the buddy is free too, so the two merge with O(1) bit and list operations per order.
+-The pair bitmap lives at the start of the region (about 1 bit per MinBlock bytes) and nothing is
+ allocated from the heap. A region that is not a power of two is carved into the largest aligned
+ blocks that fit.
+-Allocate returns nullptr when no block is large enough. Deallocate takes the size that was
+ requested, like sized delete. Neither is synchronized; Locked() runs calls under the allocator's
+ mutex, and BuddyThreadCache keeps per-thread stacks of small blocks so most calls avoid the lock.
+-BenchmarkBuddyAllocator replays one random 16 B .. 1 MiB workload against the allocator and malloc
+ and reports throughput and fragmentation.
+*/
+
+
+// Binary buddy allocator over a fixed region.
+struct BuddyAllocator {
+    static constexpr int MaxOrders = 32;
+    using OrderMask = BitMask<uint32_t>;
+
+
+    // Constructors and Initialization:
+
+
+    // Manage bytes of memory at region in blocks of at least minBlock bytes, a power of two of at
+    // least 16. The region must outlive the allocator.
+    BuddyAllocator(void* region, const size_t bytes, const size_t minBlock = 16)
+        : MinBlock(minBlock), MinShift(std::countr_zero(minBlock))
+    {
+        if (!std::has_single_bit(minBlock) || minBlock < sizeof(FreeBlock)) {
+            throw std::invalid_argument("BuddyAllocator needs a power of two minimum block of at least 16 bytes");
+        }
+        // The pair bitmap needs fewer bits than there are minimum blocks, plus one per order for rounding.
+        std::byte* begin = static_cast<std::byte*>(region);
+        std::byte* end = begin + bytes;
+        PairWords = reinterpret_cast<uint64_t*>(AlignUp(begin, alignof(uint64_t)));
+        const size_t bitmapWords = WordsFor(bytes / minBlock + MaxOrders);
+        Pool = AlignUp(reinterpret_cast<std::byte*>(PairWords + bitmapWords), minBlock);
+        if (Pool >= end) {
+            throw std::invalid_argument("BuddyAllocator region is too small for its bookkeeping");
+        }
+        Units = static_cast<size_t>(end - Pool) >> MinShift;
+        if (Units == 0) {
+            throw std::invalid_argument("BuddyAllocator region is too small for one block");
+        }
+        MaxOrder = std::min(MaxOrders - 1, static_cast<int>(std::bit_width(Units)) - 1);
+        size_t pairBits = 0;
+        for (int order = 0; order < MaxOrder; ++order) {
+            PairOffsets[order] = pairBits;
+            pairBits += (Units + (size_t(2) << order) - 1) >> (order + 1);
+        }
+        std::fill(PairWords, PairWords + WordsFor(pairBits), 0);
+
+        // Carve the pool into the largest aligned blocks that fit.
+        for (size_t unit = 0; unit < Units;) {
+            int order = std::min(MaxOrder, unit == 0 ? MaxOrder : std::countr_zero(unit));
+            while ((size_t(1) << order) > Units - unit) {
+                --order;
+            }
+            TogglePair(unit << MinShift, order);
+            Push(Pool + (unit << MinShift), order);
+            FreeBytesCount += BlockBytes(order);
+            unit += size_t(1) << order;
+        }
+    }
+
+    BuddyAllocator(const BuddyAllocator&) = delete;
+    BuddyAllocator& operator=(const BuddyAllocator&) = delete;
+
+
+    // Allocation:
+
+
+    // Smallest order whose blocks hold bytes, or -1 when bytes exceed the largest block.
+    int OrderFor(const size_t bytes) const {
+        const size_t units = bytes == 0 ? 1 : ((bytes - 1) >> MinShift) + 1;
+        const int order = static_cast<int>(std::bit_width(units - 1));
+        return order <= MaxOrder ? order : -1;
+    }
+
+    // Block of at least bytes bytes, or nullptr when none is free.
+    void* Allocate(const size_t bytes) {
+        const int order = OrderFor(bytes);
+        return order < 0 ? nullptr : AllocateOrder(order);
+    }
+
+    // Return a block from Allocate(bytes), passing the same bytes.
+    void Deallocate(void* block, const size_t bytes) {
+        if (block != nullptr) {
+            DeallocateOrder(block, OrderFor(bytes));
+        }
+    }
+
+    // Block of order order, or nullptr when none is free. Orders outside 0 .. LargestOrder() get nullptr.
+    void* AllocateOrder(int order)
+    {
+        if (order < 0 || order > MaxOrder) {
+            return nullptr;
+        }
+        const uint32_t candidates = FreeOrders.Mask & (~uint32_t(0) << order);
+        if (candidates == 0) {
+            return nullptr;
+        }
+        int from = std::countr_zero(candidates);
+        std::byte* block = Pop(from);
+        TogglePair(Offset(block), from);
+        // Split down to the requested order, freeing the upper halves.
+        while (from > order) {
+            --from;
+            std::byte* upper = block + BlockBytes(from);
+            TogglePair(Offset(upper), from);
+            Push(upper, from);
+        }
+        FreeBytesCount -= BlockBytes(order);
+        return block;
+    }
+
+    // Return a block of order order, merging it with its free buddies. order must be the one the block
+    // was allocated with, so orders outside 0 .. LargestOrder() throw std::invalid_argument.
+    void DeallocateOrder(void* memory, int order)
+    {
+        if (order < 0 || order > MaxOrder) {
+            throw std::invalid_argument("BuddyAllocator order " + std::to_string(order) + " is outside 0 .. LargestOrder()");
+        }
+        FreeBytesCount += BlockBytes(order);
+        size_t offset = Offset(static_cast<std::byte*>(memory));
+        // After the toggle, a clear pair bit means the buddy is free as well.
+        while (order < MaxOrder && !TogglePair(offset, order)) {
+            const size_t buddy = offset ^ BlockBytes(order);
+            Unlink(Pool + buddy, order);
+            offset &= ~BlockBytes(order);
+            ++order;
+        }
+        Push(Pool + offset, order);
+    }
+
+    // Run func(*this) under the allocator's mutex, for sharing it between threads.
+    template <typename Func>
+    decltype(auto) Locked(Func&& func) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        return func(*this);
+    }
+
+
+    // Query and Information:
+
+
+    // Size of a block of order order.
+    size_t BlockBytes(const int order) const {
+        return MinBlock << order;
+    }
+
+    int LargestOrder() const {
+        return MaxOrder;
+    }
+
+    // Bytes available for blocks, excluding the pair bitmap.
+    size_t PoolBytes() const {
+        return Units << MinShift;
+    }
+
+    size_t FreeBytes() const {
+        return FreeBytesCount;
+    }
+
+    // Size of the largest free block, or 0 when nothing is free.
+    size_t LargestFreeBlock() const {
+        return FreeOrders.Mask == 0 ? 0 : BlockBytes(static_cast<int>(std::bit_width(FreeOrders.Mask)) - 1);
+    }
+
+    // Orders whose free list is non-empty.
+    OrderMask FreeOrderMask() const {
+        return FreeOrders;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* Next;
+        FreeBlock* Prev;
+    };
+
+    static std::byte* AlignUp(std::byte* pointer, const size_t alignment) {
+        const uintptr_t value = reinterpret_cast<uintptr_t>(pointer);
+        return pointer + ((alignment - value % alignment) % alignment);
+    }
+
+    size_t Offset(const std::byte* block) const {
+        return static_cast<size_t>(block - Pool);
+    }
+
+    // Toggle the pair bit of the block at offset and return its new value.
+    bool TogglePair(const size_t offset, const int order)
+    {
+        if (order >= MaxOrder) {
+            return true;
+        }
+        const size_t bit = PairOffsets[order] + (offset >> (MinShift + order + 1));
+        const uint64_t mask = uint64_t(1) << (bit % WordBits);
+        PairWords[bit / WordBits] ^= mask;
+        return (PairWords[bit / WordBits] & mask) != 0;
+    }
+
+    void Push(std::byte* memory, const int order)
+    {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(memory);
+        block->Next = Heads[order];
+        block->Prev = nullptr;
+        if (Heads[order] != nullptr) {
+            Heads[order]->Prev = block;
+        }
+        Heads[order] = block;
+        FreeOrders.SetBit(static_cast<uint32_t>(order));
+    }
+
+    std::byte* Pop(const int order)
+    {
+        FreeBlock* block = Heads[order];
+        Unlink(reinterpret_cast<std::byte*>(block), order);
+        return reinterpret_cast<std::byte*>(block);
+    }
+
+    void Unlink(std::byte* memory, const int order)
+    {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(memory);
+        if (block->Prev != nullptr) {
+            block->Prev->Next = block->Next;
+        }
+        else {
+            Heads[order] = block->Next;
+        }
+        if (block->Next != nullptr) {
+            block->Next->Prev = block->Prev;
+        }
+        if (Heads[order] == nullptr) {
+            FreeOrders.ClearBit(static_cast<uint32_t>(order));
+        }
+    }
+
+    size_t MinBlock;
+    int MinShift;
+    int MaxOrder = 0;
+    std::byte* Pool = nullptr;
+    size_t Units = 0;
+    uint64_t* PairWords = nullptr;
+    size_t PairOffsets[MaxOrders] = {};
+    FreeBlock* Heads[MaxOrders] = {};
+    OrderMask FreeOrders;
+    size_t FreeBytesCount = 0;
+    std::mutex Mutex;
+};
+
+// Per-thread stacks of small blocks in front of a shared BuddyAllocator. Blocks of the cached orders
+// are taken from and returned to the allocator in batches under its lock; larger ones lock per call.
+// Cached blocks count as allocated, so they do not merge until the cache flushes them.
+struct BuddyThreadCache {
+    static constexpr int CachedOrders = 8;
+    static constexpr int CacheDepth = 32;
+
+    explicit BuddyThreadCache(BuddyAllocator& allocator) : Allocator(allocator) {}
+
+    BuddyThreadCache(const BuddyThreadCache&) = delete;
+    BuddyThreadCache& operator=(const BuddyThreadCache&) = delete;
+
+    ~BuddyThreadCache() {
+        Flush();
+    }
+
+    // Block of at least bytes bytes, or nullptr when none is free.
+    void* Allocate(const size_t bytes)
+    {
+        const int order = Allocator.OrderFor(bytes);
+        if (order < 0 || order >= CachedOrders) {
+            return order < 0 ? nullptr : Allocator.Locked([&](BuddyAllocator& shared) { return shared.AllocateOrder(order); });
+        }
+        int& count = Counts[order];
+        if (count == 0) {
+            // Refill half the stack, so a following run of frees does not flush at once.
+            Allocator.Locked([&](BuddyAllocator& shared) {
+                while (count < CacheDepth / 2) {
+                    void* block = shared.AllocateOrder(order);
+                    if (block == nullptr) {
+                        break;
+                    }
+                    Blocks[order][count++] = block;
+                }
+            });
+            if (count == 0) {
+                return nullptr;
+            }
+        }
+        return Blocks[order][--count];
+    }
+
+    // Return a block from Allocate(bytes), passing the same bytes.
+    void Deallocate(void* block, const size_t bytes)
+    {
+        if (block == nullptr) {
+            return;
+        }
+        const int order = Allocator.OrderFor(bytes);
+        if (order >= CachedOrders) {
+            Allocator.Locked([&](BuddyAllocator& shared) { shared.DeallocateOrder(block, order); });
+            return;
+        }
+        int& count = Counts[order];
+        if (count == CacheDepth) {
+            Release(order, CacheDepth / 2);
+        }
+        Blocks[order][count++] = block;
+    }
+
+    // Return every cached block to the allocator.
+    void Flush() {
+        for (int order = 0; order < CachedOrders; ++order) {
+            Release(order, Counts[order]);
+        }
+    }
+
+private:
+    void Release(const int order, const int blocks)
+    {
+        if (blocks == 0) {
+            return;
+        }
+        Allocator.Locked([&](BuddyAllocator& shared) {
+            for (int i = 0; i < blocks; ++i) {
+                shared.DeallocateOrder(Blocks[order][--Counts[order]], order);
+            }
+        });
+    }
+
+    BuddyAllocator& Allocator;
+    void* Blocks[CachedOrders][CacheDepth] = {};
+    int Counts[CachedOrders] = {};
+};
+
+// Throughput and fragmentation of one benchmark workload.
+struct BuddyBenchmarkResult {
+    size_t Operations = 0;
+    double BuddyOpsPerSecond = 0;
+    double MallocOpsPerSecond = 0;
+    // Allocations the buddy allocator could not serve although the live blocks left room.
+    size_t FailedAllocations = 0;
+    // Requested bytes over block bytes of the live allocations at the end (internal fragmentation).
+    double BlockUtilization = 0;
+    // Largest free block over all free bytes at the end; 1 means no external fragmentation.
+    double FreeContiguity = 0;
+};
+
+// Replay operations random allocations and frees of 16 B .. 1 MiB (log-uniform sizes) against a
+// BuddyAllocator over regionBytes and against malloc. The live set is kept under half the region.
+inline BuddyBenchmarkResult BenchmarkBuddyAllocator(const size_t regionBytes, const size_t operations, const uint32_t seed = 1)
+{
+    struct Op {
+        bool Allocate;
+        uint32_t Slot;
+        size_t Bytes;
+    };
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> logSize(4.0, 20.0);
+    std::vector<Op> ops;
+    std::vector<size_t> slotBytes;
+    std::vector<uint32_t> live;
+    size_t liveBytes = 0;
+    ops.reserve(operations);
+    while (ops.size() < operations) {
+        const size_t bytes = static_cast<size_t>(std::exp2(logSize(random)));
+        if (!live.empty() && (random() % 2 == 0 || liveBytes + std::bit_ceil(bytes) > regionBytes / 2)) {
+            const size_t index = random() % live.size();
+            const uint32_t slot = live[index];
+            live[index] = live.back();
+            live.pop_back();
+            liveBytes -= std::bit_ceil(slotBytes[slot]);
+            ops.push_back({ false, slot, slotBytes[slot] });
+        }
+        else if (liveBytes + std::bit_ceil(bytes) <= regionBytes / 2) {
+            const uint32_t slot = static_cast<uint32_t>(slotBytes.size());
+            slotBytes.push_back(bytes);
+            live.push_back(slot);
+            liveBytes += std::bit_ceil(bytes);
+            ops.push_back({ true, slot, bytes });
+        }
+    }
+
+    BuddyBenchmarkResult result;
+    result.Operations = ops.size();
+    std::vector<void*> pointers(slotBytes.size(), nullptr);
+    std::vector<std::byte> region(regionBytes);
+    {
+        BuddyAllocator allocator(region.data(), region.size());
+        const auto start = std::chrono::steady_clock::now();
+        for (const Op& op : ops) {
+            if (op.Allocate) {
+                pointers[op.Slot] = allocator.Allocate(op.Bytes);
+                result.FailedAllocations += pointers[op.Slot] == nullptr ? 1 : 0;
+            }
+            else {
+                allocator.Deallocate(pointers[op.Slot], op.Bytes);
+                pointers[op.Slot] = nullptr;
+            }
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.BuddyOpsPerSecond = seconds > 0 ? static_cast<double>(ops.size()) / seconds : 0;
+
+        size_t requested = 0;
+        size_t blocks = 0;
+        for (size_t slot = 0; slot < pointers.size(); ++slot) {
+            if (pointers[slot] != nullptr) {
+                requested += slotBytes[slot];
+                blocks += allocator.BlockBytes(allocator.OrderFor(slotBytes[slot]));
+            }
+        }
+        result.BlockUtilization = blocks != 0 ? static_cast<double>(requested) / static_cast<double>(blocks) : 1.0;
+        result.FreeContiguity = allocator.FreeBytes() != 0
+            ? static_cast<double>(allocator.LargestFreeBlock()) / static_cast<double>(allocator.FreeBytes()) : 1.0;
+    }
+
+    std::fill(pointers.begin(), pointers.end(), nullptr);
+    const auto start = std::chrono::steady_clock::now();
+    for (const Op& op : ops) {
+        if (op.Allocate) {
+            pointers[op.Slot] = std::malloc(op.Bytes);
+        }
+        else {
+            std::free(pointers[op.Slot]);
+            pointers[op.Slot] = nullptr;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.MallocOpsPerSecond = seconds > 0 ? static_cast<double>(ops.size()) / seconds : 0;
+    for (void* pointer : pointers) {
+        std::free(pointer);
+    }
+    return result;
+}
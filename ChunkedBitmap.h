@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "WideBitMask.h"
+
+/*
+ChunkedBitmap is a compressed bitmap over 64-bit values.
+
+-Values are split into 65536-bit chunks keyed by value >> 16.
+-A chunk stores its low 16 bits as a sorted array while it holds at most SparseLimit values and as a
+ dense WideBitMask<65536> (8 KiB) after that, so clustered ranges stay dense and scattered ids cost
+ two bytes each.
+*/
+
+
+// A compressed bitmap over 64-bit values, stored as sparse or dense 65536-bit chunks.
+struct ChunkedBitmap {
+    static constexpr int ChunkBits = 16;
+    static constexpr int ChunkSize = 1 << ChunkBits;
+    // A sorted chunk above this many values is larger than the dense 8 KiB form.
+    static constexpr size_t SparseLimit = ChunkSize / 16;
+
+    using DenseChunk = WideBitMask<ChunkSize>;
+
+    struct Chunk {
+        std::vector<uint16_t> Sparse;
+        std::unique_ptr<DenseChunk> Dense;
+        size_t Count = 0;
+    };
+
+
+    // Bit Manipulation Functions:
+
+
+    // Insert value; returns true if it was not present before.
+    bool Insert(const uint64_t value)
+    {
+        Chunk& chunk = ChunkFor(value >> ChunkBits);
+        const uint16_t low = static_cast<uint16_t>(value);
+        if (chunk.Dense) {
+            if (chunk.Dense->IsBitSet(low)) {
+                return false;
+            }
+            chunk.Dense->SetBit(low);
+        }
+        else {
+            auto it = std::lower_bound(chunk.Sparse.begin(), chunk.Sparse.end(), low);
+            if (it != chunk.Sparse.end() && *it == low) {
+                return false;
+            }
+            chunk.Sparse.insert(it, low);
+            if (chunk.Sparse.size() > SparseLimit) {
+                Densify(chunk);
+            }
+        }
+        ++chunk.Count;
+        ++Cardinality;
+        return true;
+    }
+
+    // Merge every value of other into this bitmap.
+    void Merge(const ChunkedBitmap& other)
+    {
+        for (const auto& [key, source] : other.Chunks) {
+            Chunk& chunk = Chunks[key];
+            Cardinality -= chunk.Count;
+            if (source.Dense || chunk.Dense || chunk.Sparse.size() + source.Sparse.size() > SparseLimit) {
+                Densify(chunk);
+                if (source.Dense) {
+                    *chunk.Dense += *source.Dense;
+                }
+                else {
+                    for (const uint16_t low : source.Sparse) {
+                        chunk.Dense->SetBit(low);
+                    }
+                }
+                chunk.Count = static_cast<size_t>(chunk.Dense->CountSetBits());
+            }
+            else {
+                std::vector<uint16_t> merged;
+                merged.reserve(chunk.Sparse.size() + source.Sparse.size());
+                std::set_union(chunk.Sparse.begin(), chunk.Sparse.end(),
+                    source.Sparse.begin(), source.Sparse.end(), std::back_inserter(merged));
+                chunk.Sparse.swap(merged);
+                chunk.Count = chunk.Sparse.size();
+            }
+            Cardinality += chunk.Count;
+        }
+    }
+
+    // Remove every value.
+    void ResetAllBits()
+    {
+        Chunks.clear();
+        Cardinality = 0;
+        LastChunk = nullptr;
+    }
+
+
+    // Query and Information:
+
+
+    // Check if value is present.
+    bool IsBitSet(const uint64_t value) const
+    {
+        const auto found = Chunks.find(value >> ChunkBits);
+        if (found == Chunks.end()) {
+            return false;
+        }
+        const uint16_t low = static_cast<uint16_t>(value);
+        const Chunk& chunk = found->second;
+        if (chunk.Dense) {
+            return chunk.Dense->IsBitSet(low);
+        }
+        return std::binary_search(chunk.Sparse.begin(), chunk.Sparse.end(), low);
+    }
+
+    // Number of values present.
+    size_t CountSetBits() const
+    {
+        return Cardinality;
+    }
+
+    // Call func(value) for every value, chunk by chunk (chunks are not visited in key order).
+    template <typename Func>
+    void ForEachSetBit(Func&& func) const
+    {
+        for (const auto& [key, chunk] : Chunks) {
+            const uint64_t base = key << ChunkBits;
+            if (chunk.Dense) {
+                chunk.Dense->ForEachSetBit([&](int low) { func(base | static_cast<uint64_t>(low)); });
+            }
+            else {
+                for (const uint16_t low : chunk.Sparse) {
+                    func(base | low);
+                }
+            }
+        }
+    }
+
+    // Approximate heap bytes used by the chunk payloads.
+    size_t MemoryBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& entry : Chunks) {
+            bytes += entry.second.Dense ? sizeof(DenseChunk) : entry.second.Sparse.capacity() * sizeof(uint16_t);
+        }
+        return bytes;
+    }
+
+    std::unordered_map<uint64_t, Chunk> Chunks;
+    size_t Cardinality = 0;
+
+private:
+    // Chunk for key, reusing the previous lookup for runs of ids in the same chunk.
+    Chunk& ChunkFor(const uint64_t key)
+    {
+        if (LastChunk == nullptr || LastKey != key) {
+            LastChunk = &Chunks[key];
+            LastKey = key;
+        }
+        return *LastChunk;
+    }
+
+    // Move a chunk's sorted values into dense words.
+    static void Densify(Chunk& chunk)
+    {
+        if (chunk.Dense) {
+            return;
+        }
+        chunk.Dense = std::make_unique<DenseChunk>();
+        for (const uint16_t low : chunk.Sparse) {
+            chunk.Dense->SetBit(low);
+        }
+        chunk.Sparse.clear();
+        chunk.Sparse.shrink_to_fit();
+    }
+
+    // Map nodes are stable across rehashing, so the cached chunk stays valid until ResetAllBits.
+    Chunk* LastChunk = nullptr;
+    uint64_t LastKey = 0;
+};
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "WideBitMask.h"
+
+/*
+CountedBitMask is an opt-in WideBitMask variant that keeps its cardinality up to date.
+
+-SetBit / ClearBit / ToggleBit adjust the count by looking at the bit's previous value.
+-Bulk operators use the *WordsPopCount kernels, which count the result in the same pass that
+ writes it; ~ derives the new count as TMax - count.
+-CountSetBits, AnyBitSet and AllBitsSet are O(1) reads of the cached count.
+*/
+
+
+// A wide mask that maintains its number of set bits incrementally.
+template <int TMax, typename CheckPolicy = DefaultCheckPolicy>
+struct CountedBitMask {
+    using Dense = WideBitMask<TMax, CheckPolicy>;
+    static constexpr size_t WordCount = Dense::WordCount;
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor initializes an empty mask.
+    CountedBitMask() : Count(0) {}
+
+    // Variadic template constructor for setting bits during initialization.
+    template<typename...Args>
+        requires ((std::is_integral_v<Args> || std::is_enum_v<Args>) && ...)
+    CountedBitMask(const Args&...bits) : Count(0)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Wrap an existing wide mask, counting its bits once.
+    explicit CountedBitMask(const Dense& bits) : Bits(bits), Count(bits.CountSetBits()) {}
+
+    // Reset all bits to zero.
+    void ResetAllBits() {
+        Bits.ResetAllBits();
+        Count = 0;
+    }
+
+
+    // Bit Manipulation Functions:
+
+
+    // Set a specific bit at position bitPos.
+    void SetBit(const int bitPos)
+    {
+        if (Dense::IsBitInRange(bitPos)) {
+            uint64_t& word = Bits.Words[bitPos / WordBits];
+            const uint64_t bit = uint64_t(1) << (bitPos % WordBits);
+            Count += (word & bit) == 0;
+            word |= bit;
+        }
+    }
+
+    // Set multiple bits.
+    template<typename...Args>
+    void SetBits(const Args&... bits)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Clear a specific bit at position bitPos.
+    void ClearBit(const int bitPos)
+    {
+        if (Dense::IsBitInRange(bitPos)) {
+            uint64_t& word = Bits.Words[bitPos / WordBits];
+            const uint64_t bit = uint64_t(1) << (bitPos % WordBits);
+            Count -= (word & bit) != 0;
+            word &= ~bit;
+        }
+    }
+
+    // Clear multiple bits.
+    template<typename...Args>
+    void ClearBits(const Args&... bits)
+    {
+        (ClearBit(static_cast<int>(bits)), ...);
+    }
+
+    // Toggle a specific bit at position bitPos.
+    void ToggleBit(const int bitPos)
+    {
+        if (Dense::IsBitInRange(bitPos)) {
+            uint64_t& word = Bits.Words[bitPos / WordBits];
+            const uint64_t bit = uint64_t(1) << (bitPos % WordBits);
+            Count += (word & bit) != 0 ? -1 : 1;
+            word ^= bit;
+        }
+    }
+
+    // Toggle multiple bits.
+    template<typename...Args>
+    void ToggleBits(const Args&... bits)
+    {
+        (ToggleBit(static_cast<int>(bits)), ...);
+    }
+
+
+    // Query and Information:
+
+
+    // Check if a specific bit at position pos is set.
+    bool IsBitSet(const int pos) const {
+        return Bits.IsBitSet(pos);
+    }
+
+    // Check if any bit is set, in O(1).
+    bool AnyBitSet() const {
+        return Count != 0;
+    }
+
+    // Check if all TMax bits are set, in O(1).
+    bool AllBitsSet() const {
+        return Count == TMax;
+    }
+
+    // Count the number of set bits, in O(1).
+    int CountSetBits() const {
+        return Count;
+    }
+
+    // Check if any bit in this mask is also set in otherMask.
+    bool IsAnyBitSetInRange(const CountedBitMask& otherMask) const {
+        return Count != 0 && otherMask.Count != 0 && Bits.IsAnyBitSetInRange(otherMask.Bits);
+    }
+
+    // Position of the first set bit at or after pos, or TMax when there is none.
+    int FindNextSetBit(const int pos) const {
+        return Count != 0 ? Bits.FindNextSetBit(pos) : TMax;
+    }
+
+    // Call func(pos) for every set bit in increasing order.
+    template <typename Func>
+    void ForEachSetBit(Func&& func) const {
+        if (Count != 0) {
+            Bits.ForEachSetBit(func);
+        }
+    }
+
+    // The underlying wide mask.
+    const Dense& ToDense() const {
+        return Bits;
+    }
+
+    // Convert the mask to a binary string, highest bit first.
+    std::string toBinaryString() const {
+        return Bits.toBinaryString();
+    }
+
+
+    // Bitwise Operations:
+
+
+    CountedBitMask operator+(const CountedBitMask& other) const {
+        CountedBitMask result(*this);
+        return result += other;
+    }
+
+    CountedBitMask operator-(const CountedBitMask& other) const {
+        CountedBitMask result(*this);
+        return result -= other;
+    }
+
+    CountedBitMask operator&(const CountedBitMask& other) const {
+        CountedBitMask result(*this);
+        return result &= other;
+    }
+
+    CountedBitMask operator^(const CountedBitMask& other) const {
+        CountedBitMask result(*this);
+        return result ^= other;
+    }
+
+    CountedBitMask& operator+=(const CountedBitMask& other) {
+        Count = static_cast<int>(OrWordsPopCount(Bits.Words.data(), other.Bits.Words.data(), WordCount));
+        return *this;
+    }
+
+    CountedBitMask& operator-=(const CountedBitMask& other) {
+        Count = static_cast<int>(AndNotWordsPopCount(Bits.Words.data(), other.Bits.Words.data(), WordCount));
+        return *this;
+    }
+
+    CountedBitMask& operator&=(const CountedBitMask& other) {
+        Count = static_cast<int>(AndWordsPopCount(Bits.Words.data(), other.Bits.Words.data(), WordCount));
+        return *this;
+    }
+
+    CountedBitMask& operator^=(const CountedBitMask& other) {
+        Count = static_cast<int>(XorWordsPopCount(Bits.Words.data(), other.Bits.Words.data(), WordCount));
+        return *this;
+    }
+
+    CountedBitMask operator~() const {
+        CountedBitMask result;
+        result.Bits = ~Bits;
+        result.Count = TMax - Count;
+        return result;
+    }
+
+    CountedBitMask operator<<(int shift) const {
+        CountedBitMask result(*this);
+        return result <<= shift;
+    }
+
+    CountedBitMask operator>>(int shift) const {
+        CountedBitMask result(*this);
+        return result >>= shift;
+    }
+
+    // Shifts drop bits off one end, so the count is recomputed after them.
+    CountedBitMask& operator<<=(int shift) {
+        Bits <<= shift;
+        Count = Bits.CountSetBits();
+        return *this;
+    }
+
+    CountedBitMask& operator>>=(int shift) {
+        Bits >>= shift;
+        Count = Bits.CountSetBits();
+        return *this;
+    }
+
+    // Masks with different counts can never be equal, so that check comes first.
+    bool operator==(const CountedBitMask& other) const {
+        return Count == other.Count && Bits == other.Bits;
+    }
+
+    bool operator!=(const CountedBitMask& other) const {
+        return !(*this == other);
+    }
+
+private:
+    Dense Bits;
+    int Count;
+};
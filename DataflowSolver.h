@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "DynamicBitMask.h"
+#include "Parallel.h"
+#include "WordKernels.h"
+
+/*
+DataflowSolver solves gen / kill bit-vector dataflow problems (liveness, reaching definitions,
+available expressions) over a control flow graph, one fact per bit.
+
+-Sets are wide masks: DynamicBitMask by default, or any WideBitMask when the fact count is known at
+ compile time. Every set of one problem has the same width.
+-A block's transfer is out = gen + (in - kill), computed by TransferWords in one fused word loop that
+ also reports whether any word changed; the meet is a word-wise OR (union) or AND (intersection).
+-Blocks are visited in reverse postorder (forward problems) or postorder (backward problems). The
+ worklist is a DynamicBitMask over those positions, scanned in order from a cursor, so one sweep
+ visits the pending blocks in the preferred order and loops settle in few sweeps. A block whose output
+ words did not change does not requeue its successors.
+-SolveAll solves independent problems (e.g. the functions of a module) in parallel, with workers
+ pulling the next problem from a shared counter so large functions do not stall a fixed split. All
+ problems are validated up front; anything a worker still throws is rethrown by ParallelChunks on
+ the calling thread after the workers have joined.
+*/
+
+
+enum class DataflowDirection {
+    Forward,    // in = meet of predecessors' out, out = transfer(in)
+    Backward,   // out = meet of successors' in, in = transfer(out)
+};
+
+enum class DataflowMeet {
+    Union,          // may analyses: liveness, reaching definitions
+    Intersection,   // must analyses: available expressions
+};
+
+// One function's control flow graph and per-block gen / kill sets.
+template <typename Mask = DynamicBitMask<>>
+struct DataflowProblem {
+    DataflowDirection Direction = DataflowDirection::Forward;
+    DataflowMeet Meet = DataflowMeet::Union;
+    int Entry = 0;
+    std::vector<std::vector<int>> Successors;
+    std::vector<Mask> Gen;
+    std::vector<Mask> Kill;
+    // Value flowing into the entry (forward) or out of exit blocks (backward); empty when not set.
+    std::optional<Mask> Boundary;
+};
+
+// Fixed point of a problem: In and Out per block in program order, whatever the direction.
+template <typename Mask = DynamicBitMask<>>
+struct DataflowResult {
+    std::vector<Mask> In;
+    std::vector<Mask> Out;
+    // Number of block transfers evaluated before the fixed point.
+    size_t Evaluations = 0;
+};
+
+// Worklist solver for gen / kill problems.
+template <typename Mask = DynamicBitMask<>>
+struct DataflowSolver {
+    // Solve one problem.
+    static DataflowResult<Mask> Solve(const DataflowProblem<Mask>& problem)
+    {
+        const size_t blocks = problem.Successors.size();
+        Validate(problem);
+        DataflowResult<Mask> result;
+        if (blocks == 0) {
+            return result;
+        }
+        const bool forward = problem.Direction == DataflowDirection::Forward;
+        const bool unionMeet = problem.Meet == DataflowMeet::Union;
+
+        // Flow edges run along the analysis direction.
+        std::vector<std::vector<int>> predecessors(blocks);
+        for (size_t block = 0; block < blocks; ++block) {
+            for (const int successor : problem.Successors[block]) {
+                predecessors[static_cast<size_t>(successor)].push_back(static_cast<int>(block));
+            }
+        }
+        const std::vector<std::vector<int>>& flowIn = forward ? predecessors : problem.Successors;
+        const std::vector<std::vector<int>>& flowOut = forward ? problem.Successors : predecessors;
+
+        std::vector<int> order = ReversePostorder(problem.Successors, problem.Entry);
+        if (!forward) {
+            std::reverse(order.begin(), order.end());
+        }
+        std::vector<int> position(blocks);
+        for (size_t i = 0; i < blocks; ++i) {
+            position[static_cast<size_t>(order[i])] = static_cast<int>(i);
+        }
+
+        Mask empty = problem.Gen[0];
+        empty.ResetAllBits();
+        const Mask initial = unionMeet ? empty : ~empty;
+        const Mask& boundary = problem.Boundary ? *problem.Boundary : empty;
+        // Blocks whose input includes the boundary value.
+        const auto isBoundary = [&](size_t block) {
+            return forward ? block == static_cast<size_t>(problem.Entry) : problem.Successors[block].empty();
+        };
+
+        // After[b] is the transfer output in flow direction: Out when forward, In when backward.
+        std::vector<Mask> after(blocks, initial);
+        Mask input = empty;
+        const auto meetInto = [&](Mask& target, size_t block) {
+            bool first = true;
+            const auto combine = [&](const Mask& value) {
+                if (first) {
+                    target = value;
+                    first = false;
+                }
+                else if (unionMeet) {
+                    OrWords(target.Words.data(), value.Words.data(), target.Words.size());
+                }
+                else {
+                    AndWords(target.Words.data(), value.Words.data(), target.Words.size());
+                }
+            };
+            if (isBoundary(block)) {
+                combine(boundary);
+            }
+            for (const int from : flowIn[block]) {
+                combine(after[static_cast<size_t>(from)]);
+            }
+            if (first) {
+                target = empty;
+            }
+        };
+
+        DynamicBitMask<> pending(static_cast<int>(blocks));
+        pending.SetAllBits();
+        const int count = static_cast<int>(blocks);
+        for (int cursor = 0;;) {
+            int next = pending.FindNextSetBit(cursor);
+            if (next == count) {
+                next = pending.FindNextSetBit(0);
+                if (next == count) {
+                    break;
+                }
+            }
+            pending.ClearBit(next);
+            cursor = next + 1;
+
+            const size_t block = static_cast<size_t>(order[static_cast<size_t>(next)]);
+            meetInto(input, block);
+            ++result.Evaluations;
+            Mask& output = after[block];
+            if (TransferWords(output.Words.data(), problem.Gen[block].Words.data(), input.Words.data(),
+                problem.Kill[block].Words.data(), output.Words.size())) {
+                for (const int to : flowOut[block]) {
+                    pending.SetBit(position[static_cast<size_t>(to)]);
+                }
+            }
+        }
+
+        std::vector<Mask> before(blocks, empty);
+        for (size_t block = 0; block < blocks; ++block) {
+            meetInto(before[block], block);
+        }
+        result.In = forward ? std::move(before) : std::move(after);
+        result.Out = forward ? std::move(after) : std::move(before);
+        return result;
+    }
+
+    // Solve independent problems in parallel; results are in problem order. Every problem is
+    // validated before any worker starts, so a malformed one throws invalid_argument on the caller.
+    static std::vector<DataflowResult<Mask>> SolveAll(const std::vector<DataflowProblem<Mask>>& problems)
+    {
+        for (const DataflowProblem<Mask>& problem : problems) {
+            Validate(problem);
+        }
+        std::vector<DataflowResult<Mask>> results(problems.size());
+        std::atomic<size_t> nextProblem{ 0 };
+        const size_t workers = std::min<size_t>(problems.size(), WorkerCount());
+        ParallelChunks(workers, static_cast<unsigned>(workers), [&](unsigned, size_t, size_t) {
+            for (size_t i = nextProblem++; i < problems.size(); i = nextProblem++) {
+                results[i] = Solve(problems[i]);
+            }
+        });
+        return results;
+    }
+
+    // Blocks in reverse postorder from entry, followed by unreachable blocks in index order.
+    static std::vector<int> ReversePostorder(const std::vector<std::vector<int>>& successors, const int entry)
+    {
+        const size_t blocks = successors.size();
+        std::vector<int> postorder;
+        postorder.reserve(blocks);
+        std::vector<char> visited(blocks, 0);
+        // Iterative depth first search; each frame is a block and the index of its next successor.
+        std::vector<std::pair<int, size_t>> stack;
+        stack.push_back({ entry, 0 });
+        visited[static_cast<size_t>(entry)] = 1;
+        while (!stack.empty()) {
+            auto& [block, next] = stack.back();
+            const std::vector<int>& edges = successors[static_cast<size_t>(block)];
+            if (next < edges.size()) {
+                const int successor = edges[next++];
+                if (!visited[static_cast<size_t>(successor)]) {
+                    visited[static_cast<size_t>(successor)] = 1;
+                    stack.push_back({ successor, 0 });
+                }
+            }
+            else {
+                postorder.push_back(block);
+                stack.pop_back();
+            }
+        }
+        std::vector<int> order(postorder.rbegin(), postorder.rend());
+        for (size_t block = 0; block < blocks; ++block) {
+            if (!visited[block]) {
+                order.push_back(static_cast<int>(block));
+            }
+        }
+        return order;
+    }
+
+private:
+    static void Validate(const DataflowProblem<Mask>& problem)
+    {
+        const size_t blocks = problem.Successors.size();
+        if (problem.Gen.size() != blocks || problem.Kill.size() != blocks) {
+            throw std::invalid_argument("DataflowProblem needs gen and kill sets for every block");
+        }
+        if (blocks == 0) {
+            return;
+        }
+        if (problem.Entry < 0 || static_cast<size_t>(problem.Entry) >= blocks) {
+            throw std::invalid_argument("DataflowProblem entry block is out of range");
+        }
+        const size_t words = problem.Gen[0].Words.size();
+        for (size_t block = 0; block < blocks; ++block) {
+            if (problem.Gen[block].Words.size() != words || problem.Kill[block].Words.size() != words) {
+                throw std::invalid_argument("DataflowProblem sets have different widths");
+            }
+            for (const int successor : problem.Successors[block]) {
+                if (successor < 0 || static_cast<size_t>(successor) >= blocks) {
+                    throw std::invalid_argument("DataflowProblem successor is out of range");
+                }
+            }
+        }
+        if (problem.Boundary && problem.Boundary->Words.size() != words) {
+            throw std::invalid_argument("DataflowProblem boundary has a different width");
+        }
+    }
+};
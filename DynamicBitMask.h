@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bitmask.h"
+#include "WordKernels.h"
+
+/*
+DynamicBitMask is the runtime sized counterpart of WideBitMask, for universes only known at run time
+(document counts, graph vertices, image rows).
+
+-Same bit manipulation, query and operator set as WideBitMask; the size is fixed at construction and
+ changed only through Resize.
+-Binary operators need operands of the same size and throw std::invalid_argument otherwise.
+-Bits are stored in uint64_t words; bits at or above Size() are always kept clear.
+*/
+
+
+// A bit mask whose width is chosen at run time.
+template <typename CheckPolicy = DefaultCheckPolicy>
+struct DynamicBitMask {
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor creates an empty, zero width mask.
+    DynamicBitMask() = default;
+
+    // Mask of bitCount clear bits.
+    explicit DynamicBitMask(const int bitCount) : Words(WordsFor(static_cast<size_t>(bitCount)), 0), BitCount(bitCount) {}
+
+    // Build a mask of bitCount bits from raw words; stray bits above bitCount are dropped.
+    static DynamicBitMask FromWords(const uint64_t* words, const int bitCount)
+    {
+        DynamicBitMask result(bitCount);
+        for (size_t i = 0; i < result.Words.size(); ++i) {
+            result.Words[i] = words[i];
+        }
+        result.TrimTail();
+        return result;
+    }
+
+    // Reset all bits to zero.
+    void ResetAllBits() {
+        std::fill(Words.begin(), Words.end(), 0);
+    }
+
+    // Change the width; new bits are clear and bits past the new width are dropped.
+    void Resize(const int bitCount) {
+        Words.resize(WordsFor(static_cast<size_t>(bitCount)), 0);
+        BitCount = bitCount;
+        TrimTail();
+    }
+
+    // Run CheckPolicy on bitPos against the current width; false means the operation should be skipped.
+    bool IsBitInRange(const int bitPos) const
+    {
+        return CheckPolicy::Validate(bitPos, BitCount);
+    }
+
+
+    // Bit Manipulation Functions:
+
+
+    // Set a specific bit at position bitPos.
+    void SetBit(const int bitPos)
+    {
+        if (IsBitInRange(bitPos)) {
+            Words[bitPos / WordBits] |= uint64_t(1) << (bitPos % WordBits);
+        }
+    }
+
+    // Set multiple bits.
+    template<typename...Args>
+    void SetBits(const Args&... bits)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Clear a specific bit at position bitPos.
+    void ClearBit(const int bitPos)
+    {
+        if (IsBitInRange(bitPos)) {
+            Words[bitPos / WordBits] &= ~(uint64_t(1) << (bitPos % WordBits));
+        }
+    }
+
+    // Clear multiple bits.
+    template<typename...Args>
+    void ClearBits(const Args&... bits)
+    {
+        (ClearBit(static_cast<int>(bits)), ...);
+    }
+
+    // Toggle a specific bit at position bitPos.
+    void ToggleBit(const int bitPos)
+    {
+        if (IsBitInRange(bitPos)) {
+            Words[bitPos / WordBits] ^= uint64_t(1) << (bitPos % WordBits);
+        }
+    }
+
+    // Toggle multiple bits.
+    template<typename...Args>
+    void ToggleBits(const Args&... bits)
+    {
+        (ToggleBit(static_cast<int>(bits)), ...);
+    }
+
+    // Set every bit of the mask.
+    void SetAllBits() {
+        std::fill(Words.begin(), Words.end(), ~uint64_t(0));
+        TrimTail();
+    }
+
+
+    // Query and Information:
+
+
+    // Number of bits in the mask.
+    int Size() const {
+        return BitCount;
+    }
+
+    // Number of storage words.
+    size_t WordCount() const {
+        return Words.size();
+    }
+
+    // Check if a specific bit at position pos is set.
+    bool IsBitSet(const int pos) const {
+        return IsBitInRange(pos) && ((Words[pos / WordBits] >> (pos % WordBits)) & 1) != 0;
+    }
+
+    // Check if any bit is set.
+    bool AnyBitSet() const {
+        return AnyWords(Words.data(), Words.size());
+    }
+
+    // Check if any bit in this mask is also set in otherMask.
+    bool IsAnyBitSetInRange(const DynamicBitMask& otherMask) const {
+        CheckSameSize(otherMask);
+        return IntersectsWords(Words.data(), otherMask.Words.data(), Words.size());
+    }
+
+    // Check if all Size() bits are set.
+    bool AllBitsSet() const {
+        return CountSetBits() == BitCount;
+    }
+
+    // Count the number of set bits.
+    int CountSetBits() const {
+        return static_cast<int>(PopCountWords(Words.data(), Words.size()));
+    }
+
+    // Count the bits set in both masks without building the intersection.
+    int CountSetBitsAnd(const DynamicBitMask& other) const {
+        CheckSameSize(other);
+        return static_cast<int>(AndPopCountWords(Words.data(), other.Words.data(), Words.size()));
+    }
+
+    // Position of the lowest set bit, or Size() when the mask is empty.
+    int FindFirstSetBit() const {
+        return FindNextSetBit(0);
+    }
+
+    // Position of the first set bit at or after pos, or Size() when there is none.
+    int FindNextSetBit(const int pos) const {
+        if (pos >= BitCount) {
+            return BitCount;
+        }
+        const size_t next = FindNextSetWords(Words.data(), Words.size(), static_cast<size_t>(pos < 0 ? 0 : pos));
+        return next < static_cast<size_t>(BitCount) ? static_cast<int>(next) : BitCount;
+    }
+
+    // Call func(pos) for every set bit in increasing order.
+    template <typename Func>
+    void ForEachSetBit(Func&& func) const {
+        for (size_t i = 0; i < Words.size(); ++i) {
+            uint64_t word = Words[i];
+            while (word != 0) {
+                func(static_cast<int>(i * WordBits + std::countr_zero(word)));
+                word &= word - 1;
+            }
+        }
+    }
+
+    // Convert the mask to a binary string, highest bit first.
+    std::string toBinaryString() const {
+        std::string result;
+        result.reserve(static_cast<size_t>(BitCount));
+        for (int i = BitCount - 1; i >= 0; i--) {
+            result += IsBitSet(i) ? '1' : '0';
+        }
+        return result;
+    }
+
+
+    // Bitwise Operations:
+
+
+    DynamicBitMask operator+(const DynamicBitMask& other) const {
+        DynamicBitMask result(*this);
+        return result += other;
+    }
+
+    DynamicBitMask operator-(const DynamicBitMask& other) const {
+        DynamicBitMask result(*this);
+        return result -= other;
+    }
+
+    DynamicBitMask operator&(const DynamicBitMask& other) const {
+        DynamicBitMask result(*this);
+        return result &= other;
+    }
+
+    DynamicBitMask operator^(const DynamicBitMask& other) const {
+        DynamicBitMask result(*this);
+        return result ^= other;
+    }
+
+    DynamicBitMask& operator+=(const DynamicBitMask& other) {
+        CheckSameSize(other);
+        OrWords(Words.data(), other.Words.data(), Words.size());
+        return *this;
+    }
+
+    DynamicBitMask& operator-=(const DynamicBitMask& other) {
+        CheckSameSize(other);
+        AndNotWords(Words.data(), other.Words.data(), Words.size());
+        return *this;
+    }
+
+    DynamicBitMask& operator&=(const DynamicBitMask& other) {
+        CheckSameSize(other);
+        AndWords(Words.data(), other.Words.data(), Words.size());
+        return *this;
+    }
+
+    DynamicBitMask& operator^=(const DynamicBitMask& other) {
+        CheckSameSize(other);
+        XorWords(Words.data(), other.Words.data(), Words.size());
+        return *this;
+    }
+
+    DynamicBitMask operator~() const {
+        DynamicBitMask result(*this);
+        NotWords(result.Words.data(), result.Words.size());
+        result.TrimTail();
+        return result;
+    }
+
+    DynamicBitMask operator<<(int shift) const {
+        DynamicBitMask result(*this);
+        return result <<= shift;
+    }
+
+    DynamicBitMask operator>>(int shift) const {
+        DynamicBitMask result(*this);
+        return result >>= shift;
+    }
+
+    DynamicBitMask& operator<<=(int shift) {
+        ShiftLeftWords(Words.data(), Words.size(), static_cast<size_t>(shift));
+        TrimTail();
+        return *this;
+    }
+
+    DynamicBitMask& operator>>=(int shift) {
+        ShiftRightWords(Words.data(), Words.size(), static_cast<size_t>(shift));
+        return *this;
+    }
+
+    bool operator==(const DynamicBitMask& other) const {
+        return BitCount == other.BitCount && EqualWords(Words.data(), other.Words.data(), Words.size());
+    }
+
+    bool operator!=(const DynamicBitMask& other) const {
+        return !(*this == other);
+    }
+
+    // Clear the unused bits above Size() in the last word.
+    void TrimTail() {
+        if (!Words.empty()) {
+            Words.back() &= LastWordMask(static_cast<size_t>(BitCount));
+        }
+    }
+
+    std::vector<uint64_t> Words;
+
+private:
+    void CheckSameSize(const DynamicBitMask& other) const {
+        if (BitCount != other.BitCount) {
+            throw std::invalid_argument("DynamicBitMask operands have different sizes");
+        }
+    }
+
+    int BitCount = 0;
+};
@@ -0,0 +1,370 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "WideBitMask.h"
+#include "WordKernels.h"
+
+/*
+Greedy and DSatur graph coloring with per-vertex forbidden color masks, for register allocation over
+interference graphs.
+
+-InterferenceGraph stores each vertex's row of the adjacency bit matrix, keeping only its non-zero
+ 64-bit words (word index + word, CSR style). Rows of 100K-vertex graphs cost memory in proportion
+ to their edges, and neighbors that are numbered close together (overlapping live ranges) share words.
+-Every vertex keeps a WideBitMask<256> of the colors its colored neighbors use. The lowest free color
+ is the first word whose countr_one is below 64, and the DSatur saturation degree is the mask's
+ CountSetBits.
+-Colors are limited to colorLimit (at most 256, e.g. the register count). A vertex with no free color
+ is spilled: it gets SpilledColor and forbids nothing.
+-GreedyColoring colors vertices in a given order (or largest degree first); DSaturColoring always
+ picks the vertex with the most distinct neighbor colors, then the most uncolored neighbors.
+-BenchmarkGraphColoring times both against the same algorithms on adjacency lists with per-vertex
+ std::set of neighbor colors.
+*/
+
+
+// Largest number of colors the forbidden color masks hold.
+constexpr int MaxColors = 256;
+// Color of vertices that could not be colored within the color limit.
+constexpr int SpilledColor = -1;
+
+using ColorMask = WideBitMask<MaxColors>;
+
+// Undirected graph whose adjacency rows are stored as their non-zero 64-bit words.
+struct InterferenceGraph {
+
+
+    // Constructors and Initialization:
+
+
+    // Graph of vertexCount vertices with the given undirected edges; self loops and duplicates are ignored.
+    InterferenceGraph(const int vertexCount, const std::vector<std::pair<int, int>>& edges)
+        : Vertices(vertexCount), RowStart(static_cast<size_t>(vertexCount) + 1, 0), Degrees(static_cast<size_t>(vertexCount), 0)
+    {
+        if (vertexCount < 0) {
+            throw std::invalid_argument("InterferenceGraph needs a non-negative vertex count");
+        }
+        std::vector<std::vector<int>> neighbors(static_cast<size_t>(vertexCount));
+        for (const auto& [a, b] : edges) {
+            if (a < 0 || b < 0 || a >= vertexCount || b >= vertexCount) {
+                throw std::out_of_range("InterferenceGraph edge has a vertex outside the graph");
+            }
+            if (a != b) {
+                neighbors[static_cast<size_t>(a)].push_back(b);
+                neighbors[static_cast<size_t>(b)].push_back(a);
+            }
+        }
+        for (size_t v = 0; v < neighbors.size(); ++v) {
+            std::vector<int>& row = neighbors[v];
+            std::sort(row.begin(), row.end());
+            row.erase(std::unique(row.begin(), row.end()), row.end());
+            Degrees[v] = static_cast<int>(row.size());
+            for (const int u : row) {
+                const uint32_t word = static_cast<uint32_t>(u) / WordBits;
+                if (WordIndex.size() == RowStart[v] || WordIndex.back() != word) {
+                    WordIndex.push_back(word);
+                    RowWords.push_back(0);
+                }
+                RowWords.back() |= uint64_t(1) << (static_cast<uint32_t>(u) % WordBits);
+            }
+            RowStart[v + 1] = WordIndex.size();
+        }
+    }
+
+
+    // Query and Information:
+
+
+    int VertexCount() const {
+        return Vertices;
+    }
+
+    int Degree(const int v) const {
+        return Degrees[static_cast<size_t>(v)];
+    }
+
+    // Check if a and b interfere: a binary search over a's row words.
+    bool HasEdge(const int a, const int b) const
+    {
+        const auto first = WordIndex.begin() + static_cast<std::ptrdiff_t>(RowStart[static_cast<size_t>(a)]);
+        const auto last = WordIndex.begin() + static_cast<std::ptrdiff_t>(RowStart[static_cast<size_t>(a) + 1]);
+        const auto found = std::lower_bound(first, last, static_cast<uint32_t>(b) / WordBits);
+        return found != last && *found == static_cast<uint32_t>(b) / WordBits &&
+            ((RowWords[static_cast<size_t>(found - WordIndex.begin())] >> (static_cast<uint32_t>(b) % WordBits)) & 1) != 0;
+    }
+
+    // Call func(u) for every neighbor u of v in increasing order.
+    template <typename Func>
+    void ForEachNeighbor(const int v, Func&& func) const
+    {
+        for (size_t i = RowStart[static_cast<size_t>(v)]; i < RowStart[static_cast<size_t>(v) + 1]; ++i) {
+            const int base = static_cast<int>(WordIndex[i] * WordBits);
+            for (uint64_t word = RowWords[i]; word != 0; word &= word - 1) {
+                func(base + std::countr_zero(word));
+            }
+        }
+    }
+
+    // Bytes held by the row words and their indices.
+    size_t MemoryBytes() const {
+        return RowStart.size() * sizeof(size_t) + WordIndex.size() * sizeof(uint32_t) + RowWords.size() * sizeof(uint64_t)
+            + Degrees.size() * sizeof(int);
+    }
+
+private:
+    int Vertices;
+    std::vector<size_t> RowStart;
+    std::vector<uint32_t> WordIndex;
+    std::vector<uint64_t> RowWords;
+    std::vector<int> Degrees;
+};
+
+// Colors per vertex (SpilledColor for spills) and the number of colors used.
+struct ColoringResult {
+    std::vector<int> Colors;
+    int ColorCount = 0;
+    int SpillCount = 0;
+};
+
+// Lowest color below colorLimit missing from forbidden, or SpilledColor.
+inline int LowestFreeColor(const ColorMask& forbidden, const int colorLimit)
+{
+    for (size_t i = 0; i < ColorMask::WordCount; ++i) {
+        const int taken = std::countr_one(forbidden.Words[i]);
+        if (taken != static_cast<int>(WordBits)) {
+            const int color = static_cast<int>(i * WordBits) + taken;
+            return color < colorLimit ? color : SpilledColor;
+        }
+    }
+    return SpilledColor;
+}
+
+// Check that the color limit fits in a ColorMask.
+inline void CheckColorLimit(const int colorLimit)
+{
+    if (colorLimit <= 0 || colorLimit > MaxColors) {
+        throw std::invalid_argument("Graph coloring needs a color limit between 1 and 256");
+    }
+}
+
+// Record color of v in its neighbors' forbidden masks.
+inline void ForbidColor(const InterferenceGraph& graph, std::vector<ColorMask>& forbidden, const int v, const int color)
+{
+    graph.ForEachNeighbor(v, [&](int u) { forbidden[static_cast<size_t>(u)].SetBit(color); });
+}
+
+// Color vertices in order (largest degree first when order is empty), each with its lowest free color.
+inline ColoringResult GreedyColoring(const InterferenceGraph& graph, const int colorLimit = MaxColors, std::vector<int> order = {})
+{
+    CheckColorLimit(colorLimit);
+    const size_t n = static_cast<size_t>(graph.VertexCount());
+    if (order.empty()) {
+        order.resize(n);
+        for (size_t v = 0; v < n; ++v) {
+            order[v] = static_cast<int>(v);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return graph.Degree(a) > graph.Degree(b); });
+    }
+    ColoringResult result;
+    result.Colors.assign(n, SpilledColor);
+    std::vector<ColorMask> forbidden(n);
+    for (const int v : order) {
+        const int color = LowestFreeColor(forbidden[static_cast<size_t>(v)], colorLimit);
+        result.Colors[static_cast<size_t>(v)] = color;
+        if (color == SpilledColor) {
+            ++result.SpillCount;
+            continue;
+        }
+        result.ColorCount = std::max(result.ColorCount, color + 1);
+        ForbidColor(graph, forbidden, v, color);
+    }
+    return result;
+}
+
+// DSatur: repeatedly color the vertex with the highest saturation (CountSetBits of its forbidden
+// mask), breaking ties by uncolored degree and then by lower index.
+inline ColoringResult DSaturColoring(const InterferenceGraph& graph, const int colorLimit = MaxColors)
+{
+    CheckColorLimit(colorLimit);
+    const size_t n = static_cast<size_t>(graph.VertexCount());
+    ColoringResult result;
+    result.Colors.assign(n, SpilledColor);
+    std::vector<ColorMask> forbidden(n);
+    std::vector<int> saturation(n, 0);
+    std::vector<int> uncoloredDegree(n);
+    std::vector<char> done(n, 0);
+
+    // Ordered by (saturation, uncolored degree, -index); the last element is the next vertex.
+    using Key = std::tuple<int, int, int>;
+    std::set<Key> queue;
+    for (size_t v = 0; v < n; ++v) {
+        uncoloredDegree[v] = graph.Degree(static_cast<int>(v));
+        queue.insert({ 0, uncoloredDegree[v], -static_cast<int>(v) });
+    }
+    while (!queue.empty()) {
+        const int v = -std::get<2>(*queue.rbegin());
+        queue.erase(std::prev(queue.end()));
+        done[static_cast<size_t>(v)] = 1;
+        const int color = LowestFreeColor(forbidden[static_cast<size_t>(v)], colorLimit);
+        result.Colors[static_cast<size_t>(v)] = color;
+        if (color == SpilledColor) {
+            ++result.SpillCount;
+        }
+        else {
+            result.ColorCount = std::max(result.ColorCount, color + 1);
+        }
+        graph.ForEachNeighbor(v, [&](int u) {
+            const size_t w = static_cast<size_t>(u);
+            if (done[w]) {
+                return;
+            }
+            queue.erase({ saturation[w], uncoloredDegree[w], -u });
+            --uncoloredDegree[w];
+            if (color != SpilledColor) {
+                forbidden[w].SetBit(color);
+                saturation[w] = forbidden[w].CountSetBits();
+            }
+            queue.insert({ saturation[w], uncoloredDegree[w], -u });
+        });
+    }
+    return result;
+}
+
+// Check that no two adjacent colored vertices share a color.
+inline bool IsProperColoring(const InterferenceGraph& graph, const std::vector<int>& colors)
+{
+    for (int v = 0; v < graph.VertexCount(); ++v) {
+        bool proper = true;
+        graph.ForEachNeighbor(v, [&](int u) {
+            proper = proper && (colors[static_cast<size_t>(v)] == SpilledColor || colors[static_cast<size_t>(v)] != colors[static_cast<size_t>(u)]);
+        });
+        if (!proper) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Timings of the mask based colorings against adjacency list versions of the same algorithms.
+struct ColoringBenchmarkResult {
+    int Vertices = 0;
+    size_t Edges = 0;
+    double GreedyMaskSeconds = 0;
+    double GreedyListSeconds = 0;
+    double DSaturMaskSeconds = 0;
+    double DSaturListSeconds = 0;
+    int GreedyColors = 0;
+    int DSaturColors = 0;
+    // Both representations produced the same colorings.
+    bool Agree = false;
+};
+
+// Color a random interference graph of vertexCount live ranges, each overlapping about averageDegree
+// neighbors numbered close to it, with both representations.
+inline ColoringBenchmarkResult BenchmarkGraphColoring(const int vertexCount, const int averageDegree, const uint32_t seed = 1)
+{
+    std::mt19937 random(seed);
+    std::vector<std::pair<int, int>> edges;
+    const int window = std::max(1, averageDegree);
+    for (int v = 0; v < vertexCount; ++v) {
+        for (int k = 0; k < averageDegree / 2; ++k) {
+            const int u = v + 1 + static_cast<int>(random() % static_cast<uint32_t>(window));
+            if (u < vertexCount) {
+                edges.push_back({ v, u });
+            }
+        }
+    }
+    const InterferenceGraph graph(vertexCount, edges);
+    const size_t n = static_cast<size_t>(vertexCount);
+    std::vector<std::vector<int>> adjacency(n);
+    for (int v = 0; v < vertexCount; ++v) {
+        graph.ForEachNeighbor(v, [&](int u) { adjacency[static_cast<size_t>(v)].push_back(u); });
+    }
+
+    ColoringBenchmarkResult result;
+    result.Vertices = vertexCount;
+    result.Edges = edges.size();
+    const auto time = [](auto&& run, double& seconds) {
+        const auto start = std::chrono::steady_clock::now();
+        auto value = run();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return value;
+    };
+
+    const ColoringResult greedy = time([&] { return GreedyColoring(graph); }, result.GreedyMaskSeconds);
+    const ColoringResult dsatur = time([&] { return DSaturColoring(graph); }, result.DSaturMaskSeconds);
+
+    // Adjacency list versions: each vertex keeps the set of colors its neighbors use.
+    const auto lowestMissing = [](const std::set<int>& used) {
+        int color = 0;
+        for (auto it = used.begin(); it != used.end() && *it == color; ++it) {
+            ++color;
+        }
+        return color < MaxColors ? color : SpilledColor;
+    };
+    const std::vector<int> listGreedy = time([&] {
+        std::vector<int> order(n);
+        for (size_t v = 0; v < n; ++v) {
+            order[v] = static_cast<int>(v);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return adjacency[static_cast<size_t>(a)].size() > adjacency[static_cast<size_t>(b)].size(); });
+        std::vector<int> colors(n, SpilledColor);
+        for (const int v : order) {
+            std::set<int> used;
+            for (const int u : adjacency[static_cast<size_t>(v)]) {
+                if (colors[static_cast<size_t>(u)] != SpilledColor) {
+                    used.insert(colors[static_cast<size_t>(u)]);
+                }
+            }
+            colors[static_cast<size_t>(v)] = lowestMissing(used);
+        }
+        return colors;
+    }, result.GreedyListSeconds);
+    const std::vector<int> listDSatur = time([&] {
+        std::vector<int> colors(n, SpilledColor);
+        std::vector<std::set<int>> used(n);
+        std::vector<int> uncoloredDegree(n);
+        std::set<std::tuple<int, int, int>> queue;
+        for (size_t v = 0; v < n; ++v) {
+            uncoloredDegree[v] = static_cast<int>(adjacency[v].size());
+            queue.insert({ 0, uncoloredDegree[v], -static_cast<int>(v) });
+        }
+        std::vector<char> done(n, 0);
+        while (!queue.empty()) {
+            const int v = -std::get<2>(*queue.rbegin());
+            queue.erase(std::prev(queue.end()));
+            done[static_cast<size_t>(v)] = 1;
+            const int color = lowestMissing(used[static_cast<size_t>(v)]);
+            colors[static_cast<size_t>(v)] = color;
+            for (const int u : adjacency[static_cast<size_t>(v)]) {
+                const size_t w = static_cast<size_t>(u);
+                if (!done[w]) {
+                    queue.erase({ static_cast<int>(used[w].size()), uncoloredDegree[w], -u });
+                    --uncoloredDegree[w];
+                    if (color != SpilledColor) {
+                        used[w].insert(color);
+                    }
+                    queue.insert({ static_cast<int>(used[w].size()), uncoloredDegree[w], -u });
+                }
+            }
+        }
+        return colors;
+    }, result.DSaturListSeconds);
+
+    result.GreedyColors = greedy.ColorCount;
+    result.DSaturColors = dsatur.ColorCount;
+    result.Agree = greedy.Colors == listGreedy && dsatur.Colors == listDSatur;
+    return result;
+}
@@ -0,0 +1,538 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "Arena.h"
+#include "Bitmask.h"
+
+/*
+HamtMap is a persistent hash map built as a hash array mapped trie.
+
+-Every node covers 5 hash bits. It holds two BitMask<uint32_t>: DataMap marks slots that hold an
+ entry and NodeMap marks slots that hold a child node. Entries and children are stored compacted,
+ and slot i is found at DataMap.CountSetBitsBelow(i) / NodeMap.CountSetBitsBelow(i).
+-Keys whose 64-bit hashes are equal end up in a collision node at the bottom of the trie.
+-Insert / Erase return a new map and copy only the nodes on the path to the key; everything else
+ is shared with the old map through atomic reference counts, so snapshots are cheap and can be read
+ and copied from several threads. Erase keeps the trie canonical by pulling a lone entry up into its
+ parent.
+-A Transient applies batches of updates. It edits nodes in place while the whole path to them is
+ referenced only by the transient, and copies a path only the first time it is shared.
+-Nodes come from the heap, or from a BumpArena that frees all of them when it is destroyed. The
+ arena must outlive every map using it and must not allocate from two threads at once.
+*/
+
+
+// A persistent hash map with popcount-indexed bitmap nodes.
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+struct HamtMap {
+    using Entry = std::pair<const Key, Value>;
+    using SlotMask = BitMask<uint32_t>;
+
+    static constexpr int BitsPerLevel = 5;
+    static constexpr int HashBits = 64;
+
+private:
+    struct Node {
+        std::atomic<uint32_t> RefCount{ 1 };
+        SlotMask DataMap;
+        SlotMask NodeMap;
+        uint32_t EntryCount = 0;
+        uint32_t ChildCount = 0;
+        bool Collision = false;
+
+        Entry* Entries() {
+            return reinterpret_cast<Entry*>(reinterpret_cast<char*>(this) + EntryOffset);
+        }
+
+        Node** Children() {
+            return reinterpret_cast<Node**>(reinterpret_cast<char*>(this) + ChildOffset(EntryCount));
+        }
+    };
+
+    static_assert(alignof(Entry) <= alignof(std::max_align_t), "HamtMap entries need at most max_align_t alignment");
+
+    static constexpr size_t RoundUp(const size_t value, const size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static constexpr size_t EntryOffset = RoundUp(sizeof(Node), alignof(Entry));
+
+    static constexpr size_t ChildOffset(const size_t entries) {
+        return RoundUp(EntryOffset + entries * sizeof(Entry), alignof(Node*));
+    }
+
+public:
+
+
+    // Constructors and Initialization:
+
+
+    // Empty map whose nodes come from the heap, or from arena when given.
+    explicit HamtMap(BumpArena* arena = nullptr) : Arena(arena) {}
+
+    // Copies share the whole trie.
+    HamtMap(const HamtMap& other) : Root(other.Root), Count(other.Count), Arena(other.Arena)
+    {
+        Retain(Root);
+    }
+
+    HamtMap(HamtMap&& other) noexcept : Root(std::exchange(other.Root, nullptr)), Count(std::exchange(other.Count, 0)), Arena(other.Arena) {}
+
+    HamtMap& operator=(HamtMap other) noexcept {
+        std::swap(Root, other.Root);
+        std::swap(Count, other.Count);
+        std::swap(Arena, other.Arena);
+        return *this;
+    }
+
+    ~HamtMap() {
+        Release(Root, Arena);
+    }
+
+
+    // Query and Information:
+
+
+    size_t Size() const {
+        return Count;
+    }
+
+    bool IsEmpty() const {
+        return Count == 0;
+    }
+
+    // Value stored for key, or nullptr.
+    const Value* Find(const Key& key) const {
+        return FindIn(Root, key);
+    }
+
+    bool Contains(const Key& key) const {
+        return Find(key) != nullptr;
+    }
+
+    // Call func(key, value) for every entry, in trie order.
+    template <typename Func>
+    void ForEach(Func&& func) const {
+        ForEachIn(Root, func);
+    }
+
+
+    // Persistent Updates:
+
+
+    // Map with key set to value; this map is unchanged.
+    HamtMap Insert(const Key& key, const Value& value) const {
+        HamtMap result(*this);
+        result.Set(key, value, false);
+        return result;
+    }
+
+    // Map without key; this map is unchanged.
+    HamtMap Erase(const Key& key) const {
+        HamtMap result(*this);
+        result.Remove(key, false);
+        return result;
+    }
+
+
+    // Transient Updates:
+
+
+    // A batch editor seeded from a map; edits never affect maps made before them.
+    struct Transient {
+        explicit Transient(const HamtMap& map) : Map(map) {}
+
+        void Set(const Key& key, const Value& value) {
+            Map.Set(key, value, true);
+        }
+
+        // Remove key; returns false if it was not present.
+        bool Erase(const Key& key) {
+            return Map.Remove(key, true);
+        }
+
+        const Value* Find(const Key& key) const {
+            return Map.Find(key);
+        }
+
+        size_t Size() const {
+            return Map.Size();
+        }
+
+        // Snapshot of the current contents; later edits copy the nodes it shares.
+        HamtMap Persistent() const {
+            return Map;
+        }
+
+    private:
+        HamtMap Map;
+    };
+
+    Transient ToTransient() const {
+        return Transient(*this);
+    }
+
+private:
+    static uint64_t HashOf(const Key& key) {
+        return static_cast<uint64_t>(Hash{}(key));
+    }
+
+    static uint32_t SlotOf(const uint64_t hash, const int shift) {
+        return static_cast<uint32_t>(hash >> shift) & ((1u << BitsPerLevel) - 1);
+    }
+
+
+    // Node Memory:
+
+
+    static Node* Allocate(const size_t entries, const size_t children, const bool collision, BumpArena* arena) {
+        const size_t bytes = ChildOffset(entries) + children * sizeof(Node*);
+        void* memory = arena != nullptr ? arena->Allocate(bytes) : ::operator new(bytes);
+        Node* node = new (memory) Node();
+        node->EntryCount = static_cast<uint32_t>(entries);
+        node->ChildCount = static_cast<uint32_t>(children);
+        node->Collision = collision;
+        return node;
+    }
+
+    // Free a node whose first `constructed` entries are live; children are not touched.
+    static void Free(Node* node, const size_t constructed, BumpArena* arena) {
+        for (size_t i = 0; i < constructed; ++i) {
+            node->Entries()[i].~Entry();
+        }
+        node->~Node();
+        if (arena == nullptr) {
+            ::operator delete(static_cast<void*>(node));
+        }
+    }
+
+    static void Retain(Node* node) {
+        if (node != nullptr) {
+            node->RefCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static void Release(Node* node, BumpArena* arena) {
+        if (node != nullptr && node->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            for (uint32_t i = 0; i < node->ChildCount; ++i) {
+                Release(node->Children()[i], arena);
+            }
+            Free(node, node->EntryCount, arena);
+        }
+    }
+
+    static bool IsUnique(const Node* node) {
+        return node->RefCount.load(std::memory_order_acquire) == 1;
+    }
+
+    // A node that holds exactly one entry and nothing else; its parent stores the entry inline instead.
+    static bool IsSingleton(const Node* node) {
+        return node->EntryCount == 1 && node->ChildCount == 0;
+    }
+
+
+    // Node Construction:
+
+
+    // Copy of src with the given slot maps. The entry at entryBit comes from newEntry and the child at
+    // childBit is newChild (whose reference is taken over); every other slot is copied from src.
+    Node* Rebuild(Node* src, const SlotMask dataMap, const SlotMask nodeMap, const int entryBit, const Entry* newEntry,
+        const int childBit, Node* newChild) const
+    {
+        Node* node = Allocate(static_cast<size_t>(std::popcount(dataMap.Mask)), static_cast<size_t>(std::popcount(nodeMap.Mask)), false, Arena);
+        node->DataMap = dataMap;
+        node->NodeMap = nodeMap;
+        size_t constructed = 0;
+        try {
+            for (uint32_t bits = dataMap.Mask; bits != 0; bits &= bits - 1) {
+                const int bit = std::countr_zero(bits);
+                const Entry& source = bit == entryBit ? *newEntry : src->Entries()[src->DataMap.CountSetBitsBelow(static_cast<uint32_t>(bit))];
+                new (&node->Entries()[constructed]) Entry(source);
+                ++constructed;
+            }
+        }
+        catch (...) {
+            Free(node, constructed, Arena);
+            throw;
+        }
+        size_t child = 0;
+        for (uint32_t bits = nodeMap.Mask; bits != 0; bits &= bits - 1) {
+            const int bit = std::countr_zero(bits);
+            Node* source = newChild;
+            if (bit != childBit) {
+                source = src->Children()[src->NodeMap.CountSetBitsBelow(static_cast<uint32_t>(bit))];
+                Retain(source);
+            }
+            node->Children()[child++] = source;
+        }
+        return node;
+    }
+
+    // Copy of a collision node without entry `skip` (or all of them) plus newEntry if given.
+    Node* RebuildCollision(Node* src, const size_t skip, const Entry* newEntry) const
+    {
+        const size_t entries = src->EntryCount - (skip < src->EntryCount ? 1 : 0) + (newEntry != nullptr ? 1 : 0);
+        Node* node = Allocate(entries, 0, true, Arena);
+        size_t constructed = 0;
+        try {
+            for (size_t i = 0; i < src->EntryCount; ++i) {
+                if (i != skip) {
+                    new (&node->Entries()[constructed]) Entry(src->Entries()[i]);
+                    ++constructed;
+                }
+            }
+            if (newEntry != nullptr) {
+                new (&node->Entries()[constructed]) Entry(*newEntry);
+                ++constructed;
+            }
+        }
+        catch (...) {
+            Free(node, constructed, Arena);
+            throw;
+        }
+        return node;
+    }
+
+    // Smallest subtree holding two entries whose hashes agree below shift.
+    Node* Merge(const Entry& first, const uint64_t firstHash, const Entry& second, const uint64_t secondHash, const int shift) const
+    {
+        if (shift >= HashBits) {
+            Node* node = Allocate(2, 0, true, Arena);
+            new (&node->Entries()[0]) Entry(first);
+            try {
+                new (&node->Entries()[1]) Entry(second);
+            }
+            catch (...) {
+                Free(node, 1, Arena);
+                throw;
+            }
+            return node;
+        }
+        const uint32_t firstSlot = SlotOf(firstHash, shift);
+        const uint32_t secondSlot = SlotOf(secondHash, shift);
+        if (firstSlot == secondSlot) {
+            Node* child = Merge(first, firstHash, second, secondHash, shift + BitsPerLevel);
+            Node* node = Allocate(0, 1, false, Arena);
+            node->NodeMap.SetBit(firstSlot);
+            node->Children()[0] = child;
+            return node;
+        }
+        Node* node = Allocate(2, 0, false, Arena);
+        node->DataMap.SetBits(firstSlot, secondSlot);
+        const bool firstLow = firstSlot < secondSlot;
+        new (&node->Entries()[0]) Entry(firstLow ? first : second);
+        try {
+            new (&node->Entries()[1]) Entry(firstLow ? second : first);
+        }
+        catch (...) {
+            Free(node, 1, Arena);
+            throw;
+        }
+        return node;
+    }
+
+
+    // Trie Operations:
+
+
+    static const Value* FindIn(Node* node, const Key& key) {
+        if (node == nullptr) {
+            return nullptr;
+        }
+        const uint64_t hash = HashOf(key);
+        for (int shift = 0;; shift += BitsPerLevel) {
+            if (node->Collision) {
+                for (uint32_t i = 0; i < node->EntryCount; ++i) {
+                    if (KeyEqual{}(node->Entries()[i].first, key)) {
+                        return &node->Entries()[i].second;
+                    }
+                }
+                return nullptr;
+            }
+            const uint32_t slot = SlotOf(hash, shift);
+            if (node->DataMap.IsBitSet(slot)) {
+                const Entry& entry = node->Entries()[node->DataMap.CountSetBitsBelow(slot)];
+                return KeyEqual{}(entry.first, key) ? &entry.second : nullptr;
+            }
+            if (!node->NodeMap.IsBitSet(slot)) {
+                return nullptr;
+            }
+            node = node->Children()[node->NodeMap.CountSetBitsBelow(slot)];
+        }
+    }
+
+    template <typename Func>
+    static void ForEachIn(Node* node, Func& func) {
+        if (node == nullptr) {
+            return;
+        }
+        for (uint32_t i = 0; i < node->EntryCount; ++i) {
+            func(node->Entries()[i].first, node->Entries()[i].second);
+        }
+        for (uint32_t i = 0; i < node->ChildCount; ++i) {
+            ForEachIn(node->Children()[i], func);
+        }
+    }
+
+    // Insert or replace key below node. Returns node itself when it was edited in place (only
+    // allowed when inPlace), otherwise a new node the caller owns; node is then left untouched.
+    Node* InsertIn(Node* node, const uint64_t hash, const int shift, const Key& key, const Value& value, const bool inPlace, bool& added) const
+    {
+        if (node->Collision) {
+            for (uint32_t i = 0; i < node->EntryCount; ++i) {
+                if (KeyEqual{}(node->Entries()[i].first, key)) {
+                    if (inPlace) {
+                        node->Entries()[i].second = value;
+                        return node;
+                    }
+                    const Entry entry(key, value);
+                    return RebuildCollision(node, i, &entry);
+                }
+            }
+            added = true;
+            const Entry entry(key, value);
+            return RebuildCollision(node, node->EntryCount, &entry);
+        }
+
+        const uint32_t slot = SlotOf(hash, shift);
+        const int bit = static_cast<int>(slot);
+        if (node->DataMap.IsBitSet(slot)) {
+            Entry& existing = node->Entries()[node->DataMap.CountSetBitsBelow(slot)];
+            if (KeyEqual{}(existing.first, key)) {
+                if (inPlace) {
+                    existing.second = value;
+                    return node;
+                }
+                const Entry entry(key, value);
+                return Rebuild(node, node->DataMap, node->NodeMap, bit, &entry, -1, nullptr);
+            }
+            added = true;
+            Node* child = Merge(existing, HashOf(existing.first), Entry(key, value), hash, shift + BitsPerLevel);
+            SlotMask dataMap = node->DataMap;
+            SlotMask nodeMap = node->NodeMap;
+            dataMap.ClearBit(slot);
+            nodeMap.SetBit(slot);
+            return Rebuild(node, dataMap, nodeMap, -1, nullptr, bit, child);
+        }
+        if (node->NodeMap.IsBitSet(slot)) {
+            Node*& childSlot = node->Children()[node->NodeMap.CountSetBitsBelow(slot)];
+            Node* child = childSlot;
+            Node* result = InsertIn(child, hash, shift + BitsPerLevel, key, value, inPlace && IsUnique(child), added);
+            if (result == child) {
+                return node;
+            }
+            if (inPlace) {
+                childSlot = result;
+                Release(child, Arena);
+                return node;
+            }
+            return Rebuild(node, node->DataMap, node->NodeMap, -1, nullptr, bit, result);
+        }
+        added = true;
+        const Entry entry(key, value);
+        SlotMask dataMap = node->DataMap;
+        dataMap.SetBit(slot);
+        return Rebuild(node, dataMap, node->NodeMap, bit, &entry, -1, nullptr);
+    }
+
+    // Remove key below node, with the same ownership rules as InsertIn. A returned child that is a
+    // singleton is inlined into its parent.
+    Node* EraseIn(Node* node, const uint64_t hash, const int shift, const Key& key, const bool inPlace, bool& removed) const
+    {
+        if (node->Collision) {
+            for (uint32_t i = 0; i < node->EntryCount; ++i) {
+                if (KeyEqual{}(node->Entries()[i].first, key)) {
+                    removed = true;
+                    return RebuildCollision(node, i, nullptr);
+                }
+            }
+            return node;
+        }
+
+        const uint32_t slot = SlotOf(hash, shift);
+        const int bit = static_cast<int>(slot);
+        if (node->DataMap.IsBitSet(slot)) {
+            if (!KeyEqual{}(node->Entries()[node->DataMap.CountSetBitsBelow(slot)].first, key)) {
+                return node;
+            }
+            removed = true;
+            SlotMask dataMap = node->DataMap;
+            dataMap.ClearBit(slot);
+            return Rebuild(node, dataMap, node->NodeMap, -1, nullptr, -1, nullptr);
+        }
+        if (!node->NodeMap.IsBitSet(slot)) {
+            return node;
+        }
+        Node*& childSlot = node->Children()[node->NodeMap.CountSetBitsBelow(slot)];
+        Node* child = childSlot;
+        Node* result = EraseIn(child, hash, shift + BitsPerLevel, key, inPlace && IsUnique(child), removed);
+        if (!removed) {
+            return node;
+        }
+        if (IsSingleton(result)) {
+            SlotMask dataMap = node->DataMap;
+            SlotMask nodeMap = node->NodeMap;
+            dataMap.SetBit(slot);
+            nodeMap.ClearBit(slot);
+            Node* inlined = Rebuild(node, dataMap, nodeMap, bit, &result->Entries()[0], -1, nullptr);
+            if (result != child) {
+                Release(result, Arena);
+            }
+            return inlined;
+        }
+        if (result == child) {
+            return node;
+        }
+        if (inPlace) {
+            childSlot = result;
+            Release(child, Arena);
+            return node;
+        }
+        return Rebuild(node, node->DataMap, node->NodeMap, -1, nullptr, bit, result);
+    }
+
+    void Set(const Key& key, const Value& value, const bool inPlace) {
+        bool added = false;
+        if (Root == nullptr) {
+            Root = Allocate(0, 0, false, Arena);
+        }
+        Node* result = InsertIn(Root, HashOf(key), 0, key, value, inPlace && IsUnique(Root), added);
+        if (result != Root) {
+            Release(Root, Arena);
+            Root = result;
+        }
+        Count += added ? 1 : 0;
+    }
+
+    bool Remove(const Key& key, const bool inPlace) {
+        if (Root == nullptr) {
+            return false;
+        }
+        bool removed = false;
+        Node* result = EraseIn(Root, HashOf(key), 0, key, inPlace && IsUnique(Root), removed);
+        if (result != Root) {
+            Release(Root, Arena);
+            Root = result;
+        }
+        if (removed) {
+            --Count;
+        }
+        if (Root->EntryCount == 0 && Root->ChildCount == 0) {
+            Release(Root, Arena);
+            Root = nullptr;
+        }
+        return removed;
+    }
+
+    Node* Root = nullptr;
+    size_t Count = 0;
+    BumpArena* Arena = nullptr;
+};
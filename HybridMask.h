@@ -0,0 +1,499 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "WideBitMask.h"
+
+/*
+HybridMask is a TMax wide mask that stays sparse while only a few bits are set.
+
+-Up to InlineCapacity set positions live in a small sorted inline array; the object is then about
+ InlineCapacity * 2 + 8 bytes instead of TMax / 8.
+-Setting one more bit promotes it to a heap allocated WideBitMask. Clearing bits does not demote it,
+ so a mask hovering around the threshold does not thrash; Compact() or any bitwise operator result
+ returns to the sparse form once the cardinality fits again.
+-Operators pick a kernel by representation: sparse x sparse merges sorted positions, sparse x dense
+ probes or patches the dense words per position, and dense x dense runs the word kernels.
+*/
+
+
+// A wide mask that stores few set positions inline and promotes itself to dense words.
+template <int TMax, int InlineCapacity = 8, typename CheckPolicy = DefaultCheckPolicy>
+struct HybridMask {
+    static_assert(InlineCapacity > 0 && InlineCapacity < 255, "InlineCapacity must fit the inline count");
+
+    using Dense = WideBitMask<TMax, CheckPolicy>;
+    using PosType = std::conditional_t<(TMax <= 65536), uint16_t, uint32_t>;
+
+    // Run CheckPolicy on bitPos; false means the operation should be skipped.
+    static constexpr bool IsBitInRange(const int bitPos)
+    {
+        return CheckPolicy::Validate(bitPos, TMax);
+    }
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor initializes an empty sparse mask.
+    HybridMask() : Count(0) {}
+
+    // Variadic template constructor for setting bits during initialization.
+    template<typename...Args>
+        requires ((std::is_integral_v<Args> || std::is_enum_v<Args>) && ...)
+    HybridMask(const Args&...bits) : Count(0)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Build a hybrid mask from a dense mask, choosing the representation by its cardinality.
+    explicit HybridMask(const Dense& dense) : Count(0)
+    {
+        AdoptDense(new Dense(dense));
+    }
+
+    HybridMask(const HybridMask& other) : Count(0)
+    {
+        CopyFrom(other);
+    }
+
+    HybridMask(HybridMask&& other) noexcept : Count(0)
+    {
+        StealFrom(other);
+    }
+
+    HybridMask& operator=(const HybridMask& other) {
+        if (this != &other) {
+            ResetAllBits();
+            CopyFrom(other);
+        }
+        return *this;
+    }
+
+    HybridMask& operator=(HybridMask&& other) noexcept {
+        if (this != &other) {
+            ResetAllBits();
+            StealFrom(other);
+        }
+        return *this;
+    }
+
+    ~HybridMask() {
+        ResetAllBits();
+    }
+
+    // Reset all bits to zero and release any dense storage.
+    void ResetAllBits() {
+        if (IsDense()) {
+            delete DenseWords;
+        }
+        Count = 0;
+    }
+
+    // Return to the sparse form if the cardinality fits inline again.
+    void Compact() {
+        if (IsDense() && DenseWords->CountSetBits() <= InlineCapacity) {
+            AdoptDense(std::exchange(DenseWords, nullptr));
+        }
+    }
+
+
+    // Bit Manipulation Functions:
+
+
+    // Set a specific bit at position bitPos, promoting to dense storage when the inline array is full.
+    void SetBit(const int bitPos)
+    {
+        if (!IsBitInRange(bitPos)) {
+            return;
+        }
+        if (IsDense()) {
+            DenseWords->SetBit(bitPos);
+            return;
+        }
+        PosType* end = Positions + Count;
+        PosType* it = std::lower_bound(Positions, end, static_cast<PosType>(bitPos));
+        if (it != end && *it == bitPos) {
+            return;
+        }
+        if (Count == InlineCapacity) {
+            Promote();
+            DenseWords->SetBit(bitPos);
+            return;
+        }
+        std::move_backward(it, end, end + 1);
+        *it = static_cast<PosType>(bitPos);
+        ++Count;
+    }
+
+    // Set multiple bits.
+    template<typename...Args>
+    void SetBits(const Args&... bits)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Clear a specific bit at position bitPos.
+    void ClearBit(const int bitPos)
+    {
+        if (!IsBitInRange(bitPos)) {
+            return;
+        }
+        if (IsDense()) {
+            DenseWords->ClearBit(bitPos);
+            return;
+        }
+        PosType* end = Positions + Count;
+        PosType* it = std::lower_bound(Positions, end, static_cast<PosType>(bitPos));
+        if (it != end && *it == bitPos) {
+            std::move(it + 1, end, it);
+            --Count;
+        }
+    }
+
+    // Clear multiple bits.
+    template<typename...Args>
+    void ClearBits(const Args&... bits)
+    {
+        (ClearBit(static_cast<int>(bits)), ...);
+    }
+
+    // Toggle a specific bit at position bitPos.
+    void ToggleBit(const int bitPos)
+    {
+        if (IsBitSet(bitPos)) {
+            ClearBit(bitPos);
+        }
+        else {
+            SetBit(bitPos);
+        }
+    }
+
+    // Toggle multiple bits.
+    template<typename...Args>
+    void ToggleBits(const Args&... bits)
+    {
+        (ToggleBit(static_cast<int>(bits)), ...);
+    }
+
+
+    // Query and Information:
+
+
+    // Check if the mask currently uses dense storage.
+    bool IsDense() const {
+        return Count == DenseTag;
+    }
+
+    // Check if a specific bit at position pos is set.
+    bool IsBitSet(const int pos) const {
+        if (!IsBitInRange(pos)) {
+            return false;
+        }
+        if (IsDense()) {
+            return DenseWords->IsBitSet(pos);
+        }
+        return std::binary_search(Positions, Positions + Count, static_cast<PosType>(pos));
+    }
+
+    // Check if any bit is set.
+    bool AnyBitSet() const {
+        return IsDense() ? DenseWords->AnyBitSet() : Count != 0;
+    }
+
+    // Check if any bit in this mask is also set in otherMask.
+    bool IsAnyBitSetInRange(const HybridMask& otherMask) const {
+        if (IsDense() && otherMask.IsDense()) {
+            return DenseWords->IsAnyBitSetInRange(*otherMask.DenseWords);
+        }
+        const HybridMask& sparse = IsDense() ? otherMask : *this;
+        const HybridMask& other = IsDense() ? *this : otherMask;
+        for (uint8_t i = 0; i < sparse.Count; ++i) {
+            if (other.IsBitSet(sparse.Positions[i])) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Check if all TMax bits are set.
+    bool AllBitsSet() const {
+        return CountSetBits() == TMax;
+    }
+
+    // Count the number of set bits.
+    int CountSetBits() const {
+        return IsDense() ? DenseWords->CountSetBits() : Count;
+    }
+
+    // Position of the lowest set bit, or TMax when the mask is empty.
+    int FindFirstSetBit() const {
+        if (IsDense()) {
+            return DenseWords->FindFirstSetBit();
+        }
+        return Count != 0 ? Positions[0] : TMax;
+    }
+
+    // Call func(pos) for every set bit in increasing order.
+    template <typename Func>
+    void ForEachSetBit(Func&& func) const {
+        if (IsDense()) {
+            DenseWords->ForEachSetBit(func);
+            return;
+        }
+        for (uint8_t i = 0; i < Count; ++i) {
+            func(static_cast<int>(Positions[i]));
+        }
+    }
+
+    // Copy of the mask as dense words.
+    Dense ToDense() const {
+        if (IsDense()) {
+            return *DenseWords;
+        }
+        Dense result;
+        for (uint8_t i = 0; i < Count; ++i) {
+            result.SetBit(Positions[i]);
+        }
+        return result;
+    }
+
+    // Convert the mask to a binary string, highest bit first.
+    std::string toBinaryString() const {
+        return ToDense().toBinaryString();
+    }
+
+
+    // Bitwise Operations:
+
+
+    HybridMask operator+(const HybridMask& other) const {
+        if (!IsDense() && !other.IsDense()) {
+            PosType merged[2 * InlineCapacity];
+            const PosType* end = std::set_union(Positions, Positions + Count,
+                other.Positions, other.Positions + other.Count, merged);
+            return FromSorted(merged, end);
+        }
+        if (IsDense() && other.IsDense()) {
+            return FromDense(new Dense(*DenseWords + *other.DenseWords));
+        }
+        const HybridMask& sparse = IsDense() ? other : *this;
+        Dense* result = new Dense(IsDense() ? *DenseWords : *other.DenseWords);
+        for (uint8_t i = 0; i < sparse.Count; ++i) {
+            result->SetBit(sparse.Positions[i]);
+        }
+        return FromDense(result);
+    }
+
+    HybridMask operator-(const HybridMask& other) const {
+        if (!IsDense()) {
+            // Sparse minus anything only removes positions, so the result stays sparse.
+            HybridMask result;
+            for (uint8_t i = 0; i < Count; ++i) {
+                if (!other.IsBitSet(Positions[i])) {
+                    result.Positions[result.Count++] = Positions[i];
+                }
+            }
+            return result;
+        }
+        Dense* result = new Dense(*DenseWords);
+        if (other.IsDense()) {
+            *result -= *other.DenseWords;
+        }
+        else {
+            for (uint8_t i = 0; i < other.Count; ++i) {
+                result->ClearBit(other.Positions[i]);
+            }
+        }
+        return FromDense(result);
+    }
+
+    HybridMask operator&(const HybridMask& other) const {
+        if (IsDense() && other.IsDense()) {
+            return FromDense(new Dense(*DenseWords & *other.DenseWords));
+        }
+        // Any sparse operand bounds the intersection, so probe its positions in the other mask.
+        const HybridMask& sparse = IsDense() ? other : *this;
+        const HybridMask& probe = IsDense() ? *this : other;
+        HybridMask result;
+        for (uint8_t i = 0; i < sparse.Count; ++i) {
+            if (probe.IsBitSet(sparse.Positions[i])) {
+                result.Positions[result.Count++] = sparse.Positions[i];
+            }
+        }
+        return result;
+    }
+
+    HybridMask operator^(const HybridMask& other) const {
+        if (!IsDense() && !other.IsDense()) {
+            PosType merged[2 * InlineCapacity];
+            const PosType* end = std::set_symmetric_difference(Positions, Positions + Count,
+                other.Positions, other.Positions + other.Count, merged);
+            return FromSorted(merged, end);
+        }
+        if (IsDense() && other.IsDense()) {
+            return FromDense(new Dense(*DenseWords ^ *other.DenseWords));
+        }
+        const HybridMask& sparse = IsDense() ? other : *this;
+        Dense* result = new Dense(IsDense() ? *DenseWords : *other.DenseWords);
+        for (uint8_t i = 0; i < sparse.Count; ++i) {
+            result->ToggleBit(sparse.Positions[i]);
+        }
+        return FromDense(result);
+    }
+
+    HybridMask& operator+=(const HybridMask& other) {
+        return *this = *this + other;
+    }
+
+    HybridMask& operator-=(const HybridMask& other) {
+        return *this = *this - other;
+    }
+
+    HybridMask& operator&=(const HybridMask& other) {
+        return *this = *this & other;
+    }
+
+    HybridMask& operator^=(const HybridMask& other) {
+        return *this = *this ^ other;
+    }
+
+    HybridMask operator~() const {
+        return FromDense(new Dense(~ToDense()));
+    }
+
+    HybridMask operator<<(int shift) const {
+        if (IsDense()) {
+            return FromDense(new Dense(*DenseWords << shift));
+        }
+        HybridMask result;
+        for (uint8_t i = 0; i < Count; ++i) {
+            const int pos = Positions[i] + shift;
+            if (pos < TMax) {
+                result.Positions[result.Count++] = static_cast<PosType>(pos);
+            }
+        }
+        return result;
+    }
+
+    HybridMask operator>>(int shift) const {
+        if (IsDense()) {
+            return FromDense(new Dense(*DenseWords >> shift));
+        }
+        HybridMask result;
+        for (uint8_t i = 0; i < Count; ++i) {
+            if (Positions[i] >= shift) {
+                result.Positions[result.Count++] = static_cast<PosType>(Positions[i] - shift);
+            }
+        }
+        return result;
+    }
+
+    HybridMask& operator<<=(int shift) {
+        return *this = *this << shift;
+    }
+
+    HybridMask& operator>>=(int shift) {
+        return *this = *this >> shift;
+    }
+
+    bool operator==(const HybridMask& other) const {
+        if (!IsDense() && !other.IsDense()) {
+            return std::equal(Positions, Positions + Count, other.Positions, other.Positions + other.Count);
+        }
+        if (IsDense() && other.IsDense()) {
+            return *DenseWords == *other.DenseWords;
+        }
+        const HybridMask& sparse = IsDense() ? other : *this;
+        const HybridMask& dense = IsDense() ? *this : other;
+        if (dense.DenseWords->CountSetBits() != sparse.Count) {
+            return false;
+        }
+        for (uint8_t i = 0; i < sparse.Count; ++i) {
+            if (!dense.DenseWords->IsBitSet(sparse.Positions[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const HybridMask& other) const {
+        return !(*this == other);
+    }
+
+private:
+    static constexpr uint8_t DenseTag = 0xFF;
+
+    // Move the inline positions into freshly allocated dense words.
+    void Promote() {
+        Dense* dense = new Dense();
+        for (uint8_t i = 0; i < Count; ++i) {
+            dense->SetBit(Positions[i]);
+        }
+        DenseWords = dense;
+        Count = DenseTag;
+    }
+
+    // Take ownership of dense, demoting to inline positions when they fit. The mask must be empty.
+    void AdoptDense(Dense* dense) {
+        if (dense->CountSetBits() > InlineCapacity) {
+            DenseWords = dense;
+            Count = DenseTag;
+            return;
+        }
+        Count = 0;
+        dense->ForEachSetBit([this](int pos) { Positions[Count++] = static_cast<PosType>(pos); });
+        delete dense;
+    }
+
+    static HybridMask FromDense(Dense* dense) {
+        HybridMask result;
+        result.AdoptDense(dense);
+        return result;
+    }
+
+    static HybridMask FromSorted(const PosType* begin, const PosType* end) {
+        HybridMask result;
+        if (end - begin > InlineCapacity) {
+            result.Promote();
+            for (const PosType* it = begin; it != end; ++it) {
+                result.DenseWords->SetBit(*it);
+            }
+            return result;
+        }
+        result.Count = static_cast<uint8_t>(std::copy(begin, end, result.Positions) - result.Positions);
+        return result;
+    }
+
+    void CopyFrom(const HybridMask& other) {
+        if (other.IsDense()) {
+            DenseWords = new Dense(*other.DenseWords);
+        }
+        else {
+            std::copy(other.Positions, other.Positions + other.Count, Positions);
+        }
+        Count = other.Count;
+    }
+
+    void StealFrom(HybridMask& other) {
+        if (other.IsDense()) {
+            DenseWords = other.DenseWords;
+        }
+        else {
+            std::copy(other.Positions, other.Positions + other.Count, Positions);
+        }
+        Count = other.Count;
+        other.Count = 0;
+    }
+
+    union {
+        PosType Positions[InlineCapacity];
+        Dense* DenseWords;
+    };
+    uint8_t Count;
+};
@@ -0,0 +1,481 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "DynamicBitMask.h"
+#include "Parallel.h"
+#include "WordKernels.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*
+LifeGrid runs Life-like cellular automata (Conway's Game of Life and other B/S rules) on a grid
+whose rows are DynamicBitMask rows, one bit per cell, with dead cells beyond the edges.
+
+-A generation is computed 64 cells per word without counting neighbors one by one. Each row's left
+ and right neighbor words are the row shifted by one bit, with the carry taken from the adjacent
+ word. Full adders over (left, center, right) of the rows above and below, and a half adder over
+ (left, right) of the row itself, give bit-sliced partial sums; two more carry-save stages turn
+ them into the four bits of the neighbor count (0 to 8) for every cell of the word at once.
+-Rows are processed two at a time: the four input rows of an output row pair are shifted once and
+ shared by both outputs. With AVX2 the interior words go four to a 256-bit register, the neighbor
+ carries coming from unaligned loads one word to either side.
+-Row pairs are split across WorkerCount() threads, each writing its own rows of the next grid.
+-Conway's rule (B3/S23) has its own kernel; other rules test the count bits against each count the
+ rule names.
+-BenchmarkLife times the kernel against a step written with the DynamicBitMask operators (<<, >>,
+ +, -, &, ^), which exercises their multi-word shift carries, and checks that both agree.
+*/
+
+
+// Birth and survival neighbor counts of a Life-like rule, bit c set for count c.
+struct LifeRule {
+    uint16_t Birth = 0;
+    uint16_t Survival = 0;
+
+    // Conway's Game of Life: B3/S23.
+    static constexpr LifeRule Conway() {
+        return LifeRule{ uint16_t(1) << 3, (uint16_t(1) << 2) | (uint16_t(1) << 3) };
+    }
+
+    // Parse a rule in B/S notation, e.g. "B3/S23" or "B36/S23".
+    static LifeRule Parse(const std::string_view text)
+    {
+        LifeRule rule;
+        uint16_t* counts = nullptr;
+        bool sawBirth = false;
+        bool sawSurvival = false;
+        for (const char c : text) {
+            if ((c == 'B' || c == 'b') && !sawBirth) {
+                counts = &rule.Birth;
+                sawBirth = true;
+            }
+            else if ((c == 'S' || c == 's') && !sawSurvival) {
+                counts = &rule.Survival;
+                sawSurvival = true;
+            }
+            else if (c >= '0' && c <= '8' && counts != nullptr) {
+                *counts |= uint16_t(1) << (c - '0');
+            }
+            else if (c != '/') {
+                throw std::invalid_argument("LifeRule expects B/S notation such as B3/S23");
+            }
+        }
+        if (!sawBirth || !sawSurvival) {
+            throw std::invalid_argument("LifeRule expects B/S notation such as B3/S23");
+        }
+        return rule;
+    }
+
+    bool operator==(const LifeRule& other) const {
+        return Birth == other.Birth && Survival == other.Survival;
+    }
+};
+
+// A grid of cells stepped by a Life-like rule.
+struct LifeGrid {
+    // Minimum number of row pairs a worker steps before a generation goes parallel.
+    static constexpr size_t RowPairsPerChunk = 64;
+
+
+    // Constructors and Initialization:
+
+
+    // All dead grid of width x height cells.
+    LifeGrid(const int width, const int height, const LifeRule rule = LifeRule::Conway())
+        : RuleValue(rule), IsConway(rule == LifeRule::Conway()), Columns(width),
+        Rows(CheckedHeight(width, height), DynamicBitMask<>(width)), Next(Rows), Empty(width) {}
+
+    void SetCell(const int x, const int y, const bool alive = true)
+    {
+        CheckCell(x, y);
+        if (alive) {
+            Rows[static_cast<size_t>(y)].SetBit(x);
+        }
+        else {
+            Rows[static_cast<size_t>(y)].ClearBit(x);
+        }
+    }
+
+    // Fill every cell at random, alive with the given probability.
+    void Randomize(const double density, const uint64_t seed)
+    {
+        std::mt19937_64 random(seed);
+        std::bernoulli_distribution alive(density);
+        for (DynamicBitMask<>& row : Rows) {
+            row.ResetAllBits();
+            for (int x = 0; x < Columns; ++x) {
+                if (alive(random)) {
+                    row.SetBit(x);
+                }
+            }
+        }
+    }
+
+    // Advance the grid by the given number of generations.
+    void Step(const int generations = 1)
+    {
+        const size_t pairs = (Rows.size() + 1) / 2;
+        const unsigned chunks = ChunksFor(pairs, RowPairsPerChunk);
+        for (int g = 0; g < generations; ++g) {
+            ParallelChunks(pairs, chunks, [&](unsigned, size_t begin, size_t end) {
+                for (size_t pair = begin; pair < end; ++pair) {
+                    StepRowPair(2 * pair);
+                }
+            });
+            Rows.swap(Next);
+            ++Generations;
+        }
+    }
+
+
+    // Query and Information:
+
+
+    int Width() const {
+        return Columns;
+    }
+
+    int Height() const {
+        return static_cast<int>(Rows.size());
+    }
+
+    const LifeRule& Rule() const {
+        return RuleValue;
+    }
+
+    // Generations stepped since construction.
+    uint64_t Generation() const {
+        return Generations;
+    }
+
+    bool IsAlive(const int x, const int y) const {
+        CheckCell(x, y);
+        return Rows[static_cast<size_t>(y)].IsBitSet(x);
+    }
+
+    // Cells of row y, bit x for column x.
+    const DynamicBitMask<>& Row(const int y) const {
+        return Rows[static_cast<size_t>(y)];
+    }
+
+    // Number of live cells.
+    size_t Population() const {
+        size_t count = 0;
+        for (const DynamicBitMask<>& row : Rows) {
+            count += PopCountWords(row.Words.data(), row.Words.size());
+        }
+        return count;
+    }
+
+    // Rows top to bottom, '#' for live cells and '.' for dead ones.
+    std::string ToString() const {
+        std::string result;
+        result.reserve(Rows.size() * static_cast<size_t>(Columns + 1));
+        for (const DynamicBitMask<>& row : Rows) {
+            for (int x = 0; x < Columns; ++x) {
+                result += row.IsBitSet(x) ? '#' : '.';
+            }
+            result += '\n';
+        }
+        return result;
+    }
+
+    bool operator==(const LifeGrid& other) const {
+        return Columns == other.Columns && RuleValue == other.RuleValue && Rows == other.Rows;
+    }
+
+    // One generation written with the DynamicBitMask operators, for benchmarks and cross-checks.
+    void StepWithOperators()
+    {
+        const auto fullAdd = [](const DynamicBitMask<>& a, const DynamicBitMask<>& b, const DynamicBitMask<>& c) {
+            const DynamicBitMask<> ab = a ^ b;
+            return std::pair{ ab ^ c, (a & b) + (ab & c) };
+        };
+        std::vector<DynamicBitMask<>> next;
+        next.reserve(Rows.size());
+        for (size_t y = 0; y < Rows.size(); ++y) {
+            const DynamicBitMask<>& row = Rows[y];
+            const DynamicBitMask<>& above = y > 0 ? Rows[y - 1] : Empty;
+            const DynamicBitMask<>& below = y + 1 < Rows.size() ? Rows[y + 1] : Empty;
+            const auto [topSum, topCarry] = fullAdd(above << 1, above, above >> 1);
+            const auto [bottomSum, bottomCarry] = fullAdd(below << 1, below, below >> 1);
+            const DynamicBitMask<> left = row << 1;
+            const DynamicBitMask<> right = row >> 1;
+            const auto [ones, onesCarry] = fullAdd(topSum, bottomSum, left ^ right);
+            const auto [twosPartial, fours] = fullAdd(topCarry, bottomCarry, left & right);
+            const DynamicBitMask<> twos = twosPartial ^ onesCarry;
+            const DynamicBitMask<> twosCarry = twosPartial & onesCarry;
+            const DynamicBitMask<> count[4] = { ones, twos, fours ^ twosCarry, fours & twosCarry };
+
+            DynamicBitMask<> alive(Columns);
+            for (int c = 0; c <= 8; ++c) {
+                const bool birth = ((RuleValue.Birth >> c) & 1) != 0;
+                const bool survival = ((RuleValue.Survival >> c) & 1) != 0;
+                if (!birth && !survival) {
+                    continue;
+                }
+                DynamicBitMask<> match = ~DynamicBitMask<>(Columns);
+                for (int bit = 0; bit < 4; ++bit) {
+                    match = ((c >> bit) & 1) != 0 ? match & count[bit] : match - count[bit];
+                }
+                alive += birth && survival ? match : birth ? match - row : match & row;
+            }
+            next.push_back(std::move(alive));
+        }
+        Rows = std::move(next);
+        ++Generations;
+    }
+
+private:
+#if defined(__AVX2__)
+    // Four adjacent words of a row in one register.
+    struct Lanes {
+        __m256i V;
+
+        static constexpr size_t Width = 4;
+
+        static Lanes Load(const uint64_t* words) {
+            return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words)) };
+        }
+
+        void Store(uint64_t* words) const {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(words), V);
+        }
+
+        // Word i's left neighbors (cell x - 1 moved to x) given the words starting at i - 1.
+        static Lanes Left(const Lanes center, const uint64_t* previous) {
+            return { _mm256_or_si256(_mm256_slli_epi64(center.V, 1), _mm256_srli_epi64(Load(previous).V, 63)) };
+        }
+
+        // Word i's right neighbors (cell x + 1 moved to x) given the words starting at i + 1.
+        static Lanes Right(const Lanes center, const uint64_t* following) {
+            return { _mm256_or_si256(_mm256_srli_epi64(center.V, 1), _mm256_slli_epi64(Load(following).V, 63)) };
+        }
+
+        static Lanes Ones() {
+            return { _mm256_set1_epi64x(-1) };
+        }
+
+        friend Lanes operator&(const Lanes a, const Lanes b) { return { _mm256_and_si256(a.V, b.V) }; }
+        friend Lanes operator|(const Lanes a, const Lanes b) { return { _mm256_or_si256(a.V, b.V) }; }
+        friend Lanes operator^(const Lanes a, const Lanes b) { return { _mm256_xor_si256(a.V, b.V) }; }
+        friend Lanes AndNot(const Lanes a, const Lanes b) { return { _mm256_andnot_si256(b.V, a.V) }; }
+    };
+#endif
+
+    // One word; the edge words and grids without AVX2.
+    struct Word {
+        uint64_t V;
+
+        static constexpr size_t Width = 1;
+
+        static Word Load(const uint64_t* words) {
+            return { *words };
+        }
+
+        void Store(uint64_t* words) const {
+            *words = V;
+        }
+
+        static Word Ones() {
+            return { ~uint64_t(0) };
+        }
+
+        friend Word operator&(const Word a, const Word b) { return { a.V & b.V }; }
+        friend Word operator|(const Word a, const Word b) { return { a.V | b.V }; }
+        friend Word operator^(const Word a, const Word b) { return { a.V ^ b.V }; }
+        friend Word AndNot(const Word a, const Word b) { return { a.V & ~b.V }; }
+    };
+
+    // Bit-sliced sum and carry of three inputs.
+    template <typename Lane>
+    static void FullAdd(const Lane a, const Lane b, const Lane c, Lane& sum, Lane& carry)
+    {
+        const Lane ab = a ^ b;
+        sum = ab ^ c;
+        carry = (a & b) | (ab & c);
+    }
+
+    // Left, center and right neighbors of one row, as a full adder (top and bottom rows) and as a
+    // half adder without the center (the row itself).
+    template <typename Lane>
+    struct RowSums {
+        Lane Center, Sum3, Carry3, Sum2, Carry2;
+
+        RowSums(const Lane center, const Lane left, const Lane right) : Center(center)
+        {
+            FullAdd(left, center, right, Sum3, Carry3);
+            Sum2 = left ^ right;
+            Carry2 = left & right;
+        }
+    };
+
+    // Next state of a row from the sums of the rows above, itself and below.
+    template <typename Lane>
+    Lane NextState(const RowSums<Lane>& top, const RowSums<Lane>& middle, const RowSums<Lane>& bottom) const
+    {
+        Lane ones, onesCarry, twosPartial, fours;
+        FullAdd(top.Sum3, middle.Sum2, bottom.Sum3, ones, onesCarry);
+        FullAdd(top.Carry3, middle.Carry2, bottom.Carry3, twosPartial, fours);
+        const Lane twos = twosPartial ^ onesCarry;
+        const Lane twosCarry = twosPartial & onesCarry;
+        const Lane eights = fours & twosCarry;
+        const Lane foursBit = fours ^ twosCarry;
+        const Lane alive = middle.Center;
+        if (IsConway) {
+            // Exactly 3, or exactly 2 on a live cell: bit 1 set, bits 2 and 3 clear, bit 0 or alive.
+            return AndNot(AndNot(twos & (ones | alive), foursBit), eights);
+        }
+        const Lane count[4] = { ones, twos, foursBit, eights };
+        Lane next = AndNot(alive, alive);
+        for (int c = 0; c <= 8; ++c) {
+            const bool birth = ((RuleValue.Birth >> c) & 1) != 0;
+            const bool survival = ((RuleValue.Survival >> c) & 1) != 0;
+            if (!birth && !survival) {
+                continue;
+            }
+            Lane match = Lane::Ones();
+            for (int bit = 0; bit < 4; ++bit) {
+                match = ((c >> bit) & 1) != 0 ? match & count[bit] : AndNot(match, count[bit]);
+            }
+            next = next | (birth && survival ? match : birth ? AndNot(match, alive) : match & alive);
+        }
+        return next;
+    }
+
+    // Row sums of word i of row, with the neighbor carries from words i - 1 and i + 1.
+    template <typename Lane>
+    static RowSums<Lane> SumsAt(const uint64_t* row, const size_t i, const size_t count)
+    {
+        const Lane center = Lane::Load(row + i);
+        if constexpr (Lane::Width == 1) {
+            const uint64_t previous = i > 0 ? row[i - 1] >> 63 : 0;
+            const uint64_t following = i + 1 < count ? row[i + 1] << 63 : 0;
+            return RowSums<Lane>(center, Lane{ (center.V << 1) | previous }, Lane{ (center.V >> 1) | following });
+        }
+        else {
+            return RowSums<Lane>(center, Lane::Left(center, row + i - 1), Lane::Right(center, row + i + 1));
+        }
+    }
+
+    // Step words [i, i + Lane::Width) of output rows y and y + 1 (when it exists).
+    template <typename Lane>
+    void StepWords(const uint64_t* const (&input)[4], uint64_t* first, uint64_t* second, const size_t i, const size_t count) const
+    {
+        const RowSums<Lane> a = SumsAt<Lane>(input[0], i, count);
+        const RowSums<Lane> b = SumsAt<Lane>(input[1], i, count);
+        const RowSums<Lane> c = SumsAt<Lane>(input[2], i, count);
+        NextState(a, b, c).Store(first + i);
+        if (second != nullptr) {
+            NextState(b, c, SumsAt<Lane>(input[3], i, count)).Store(second + i);
+        }
+    }
+
+    // Compute rows y and y + 1 of the next generation from rows y - 1 to y + 2.
+    void StepRowPair(const size_t y)
+    {
+        const size_t height = Rows.size();
+        const auto rowAt = [&](size_t r) { return r < height ? Rows[r].Words.data() : Empty.Words.data(); };
+        const uint64_t* const input[4] = { y > 0 ? Rows[y - 1].Words.data() : Empty.Words.data(), rowAt(y), rowAt(y + 1), rowAt(y + 2) };
+        uint64_t* first = Next[y].Words.data();
+        uint64_t* second = y + 1 < height ? Next[y + 1].Words.data() : nullptr;
+        const size_t count = Empty.Words.size();
+
+        size_t i = 0;
+#if defined(__AVX2__)
+        // Interior words, whose neighbor words on both sides exist.
+        if (count > Lanes::Width + 1) {
+            StepWords<Word>(input, first, second, 0, count);
+            for (i = 1; i + Lanes::Width < count; i += Lanes::Width) {
+                StepWords<Lanes>(input, first, second, i, count);
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            StepWords<Word>(input, first, second, i, count);
+        }
+        // Cells past the right edge stay dead.
+        first[count - 1] &= LastWordMask(static_cast<size_t>(Columns));
+        if (second != nullptr) {
+            second[count - 1] &= LastWordMask(static_cast<size_t>(Columns));
+        }
+    }
+
+    void CheckCell(const int x, const int y) const
+    {
+        if (x < 0 || y < 0 || x >= Columns || y >= Height()) {
+            throw std::out_of_range("LifeGrid cell is outside the grid");
+        }
+    }
+
+    static size_t CheckedHeight(const int width, const int height)
+    {
+        if (width <= 0 || height <= 0) {
+            throw std::invalid_argument("LifeGrid needs a positive width and height");
+        }
+        return static_cast<size_t>(height);
+    }
+
+    LifeRule RuleValue;
+    bool IsConway;
+    int Columns;
+    std::vector<DynamicBitMask<>> Rows;
+    std::vector<DynamicBitMask<>> Next;
+    // A dead row beyond the top and bottom edges.
+    DynamicBitMask<> Empty;
+    uint64_t Generations = 0;
+};
+
+// Timings of the word kernel against the operator based step on the same random grid.
+struct LifeBenchmarkResult {
+    int Width = 0;
+    int Height = 0;
+    int Generations = 0;
+    double KernelSeconds = 0;
+    double OperatorSeconds = 0;
+    // Cell updates per second of the word kernel.
+    double CellUpdatesPerSecond = 0;
+    size_t Population = 0;
+    // Both steps produced the same grid.
+    bool Agree = false;
+};
+
+// Step a random grid (density 1/3) with both the kernel and the operator based step.
+inline LifeBenchmarkResult BenchmarkLife(const int width, const int height, const int generations, const uint64_t seed = 1)
+{
+    LifeBenchmarkResult result;
+    result.Width = width;
+    result.Height = height;
+    result.Generations = generations;
+    LifeGrid kernel(width, height);
+    kernel.Randomize(1.0 / 3, seed);
+    LifeGrid operators = kernel;
+
+    const auto start = std::chrono::steady_clock::now();
+    kernel.Step(generations);
+    const auto middle = std::chrono::steady_clock::now();
+    for (int g = 0; g < generations; ++g) {
+        operators.StepWithOperators();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    result.KernelSeconds = std::chrono::duration<double>(middle - start).count();
+    result.OperatorSeconds = std::chrono::duration<double>(end - middle).count();
+    result.CellUpdatesPerSecond = result.KernelSeconds > 0
+        ? static_cast<double>(width) * height * generations / result.KernelSeconds : 0;
+    result.Population = kernel.Population();
+    result.Agree = kernel == operators;
+    return result;
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "DynamicBitMask.h"
+#include "RankSelect.h"
+
+/*
+LoudsTrie is a static succinct trie over byte strings, for large read-only dictionaries.
+
+-The tree shape is a LOUDS bit sequence: after a "10" super root, every node in breadth first order
+ writes one 1 per child and a 0. Node ids are breadth first positions (the root is 0); the child at
+ LOUDS position p is node Rank1(p), and node x's children start after the x-th zero.
+-Child, parent and lookup are rank / select queries on the LOUDS bits (RankSelectBits); each node's
+ edge label is one byte, stored in node order, and children are found by binary search over their
+ sorted labels.
+-A second bit sequence marks the nodes that end a key; its Rank1 turns a node into a dense key id in
+ [0, KeyCount()) for indexing values, and its Select1 maps a key id back to its node.
+-Space is about 2 LOUDS bits, 8 label bits and 1 terminal bit per node plus the rank / select
+ directories: roughly 1.6 bytes per node against tens of bytes for a pointer trie.
+-Build() takes sorted keys and emits the trie level by level. WriteTo / ReadFrom save and load an
+ image; MapFrom (Linux) memory-maps the image read-only and queries it in place without parsing.
+*/
+
+
+// A static LOUDS encoded trie over byte strings.
+struct LoudsTrie {
+    static constexpr size_t NoNode = static_cast<size_t>(-1);
+    static constexpr size_t NoKey = static_cast<size_t>(-1);
+    static constexpr uint64_t Magic = 0x0001'0000'544C'4D42; // "BMLT", version 1
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor creates an empty trie with no keys.
+    LoudsTrie() : LoudsTrie(Build({})) {}
+
+    // Build the trie of keys, which must be sorted; duplicates are stored once.
+    static LoudsTrie Build(const std::vector<std::string_view>& keys)
+    {
+        for (size_t i = 1; i < keys.size(); ++i) {
+            if (keys[i] < keys[i - 1]) {
+                throw std::invalid_argument("LoudsTrie::Build needs sorted keys");
+            }
+        }
+
+        // Keys [Begin, End) share the prefix of the node being emitted.
+        struct KeyRange {
+            size_t Begin;
+            size_t End;
+        };
+        BitWriter louds;
+        BitWriter terminals;
+        std::vector<uint8_t> labels;
+        louds.Append(true);
+        louds.Append(false);
+        std::vector<KeyRange> level;
+        std::vector<KeyRange> next;
+        level.push_back({ 0, keys.size() });
+        for (size_t depth = 0; !level.empty(); ++depth) {
+            next.clear();
+            for (const KeyRange range : level) {
+                // Sorted order puts the key that ends here first, followed by its duplicates.
+                size_t begin = range.Begin;
+                const bool terminal = begin < range.End && keys[begin].size() == depth;
+                while (begin < range.End && keys[begin].size() == depth) {
+                    ++begin;
+                }
+                terminals.Append(terminal);
+                while (begin < range.End) {
+                    const char label = keys[begin][depth];
+                    size_t end = begin + 1;
+                    while (end < range.End && keys[end][depth] == label) {
+                        ++end;
+                    }
+                    louds.Append(true);
+                    labels.push_back(static_cast<uint8_t>(label));
+                    next.push_back({ begin, end });
+                    begin = end;
+                }
+                louds.Append(false);
+            }
+            level.swap(next);
+        }
+
+        LoudsTrie trie(RankSelectBits(louds.Finish()), RankSelectBits(terminals.Finish()));
+        trie.OwnedLabels = std::move(labels);
+        trie.Labels = trie.OwnedLabels.data();
+        return trie;
+    }
+
+
+    // Navigation:
+
+
+    size_t Root() const {
+        return 0;
+    }
+
+    // Children of node: ids first .. first + count - 1, in label order.
+    std::pair<size_t, size_t> Children(const size_t node) const
+    {
+        const size_t begin = Louds.Select0(node) + 1;
+        const size_t end = FindNextClearWords(Louds.Data(), WordsFor(Louds.Size()), begin);
+        return { Louds.Rank1(begin), end - begin };
+    }
+
+    // First child of node, or NoNode for a leaf.
+    size_t FirstChild(const size_t node) const {
+        const auto [first, count] = Children(node);
+        return count != 0 ? first : NoNode;
+    }
+
+    // Child of node along the edge labelled label, or NoNode.
+    size_t Child(const size_t node, const uint8_t label) const
+    {
+        const auto [first, count] = Children(node);
+        // Labels are stored from node 1 on, so node x's label is Labels[x - 1].
+        const uint8_t* labels = Labels + first - 1;
+        const uint8_t* found = std::lower_bound(labels, labels + count, label);
+        return found != labels + count && *found == label ? first + static_cast<size_t>(found - labels) : NoNode;
+    }
+
+    // Parent of node, or NoNode for the root.
+    size_t Parent(const size_t node) const {
+        return node == 0 ? NoNode : Louds.Rank0(Louds.Select1(node)) - 1;
+    }
+
+    // Label of the edge from node's parent to node; node must not be the root.
+    uint8_t Label(const size_t node) const {
+        return Labels[node - 1];
+    }
+
+    // Check if the path to node spells a key.
+    bool IsKey(const size_t node) const {
+        return Terminals.IsBitSet(node);
+    }
+
+    // Dense id of the key ending at node, which must be a key node.
+    size_t KeyId(const size_t node) const {
+        return Terminals.Rank1(node);
+    }
+
+    // Node reached by following prefix from the root, or NoNode.
+    size_t FindNode(const std::string_view prefix) const
+    {
+        size_t node = Root();
+        for (size_t i = 0; i < prefix.size() && node != NoNode; ++i) {
+            node = Child(node, static_cast<uint8_t>(prefix[i]));
+        }
+        return node;
+    }
+
+
+    // Query and Information:
+
+
+    // Number of nodes, including the root.
+    size_t NodeCount() const {
+        return Terminals.Size();
+    }
+
+    // Number of distinct keys.
+    size_t KeyCount() const {
+        return Terminals.Ones();
+    }
+
+    // Key id of key, or NoKey when it is not in the trie.
+    size_t Lookup(const std::string_view key) const {
+        const size_t node = FindNode(key);
+        return node != NoNode && IsKey(node) ? KeyId(node) : NoKey;
+    }
+
+    bool Contains(const std::string_view key) const {
+        return Lookup(key) != NoKey;
+    }
+
+    // The key with id keyId.
+    std::string KeyAt(const size_t keyId) const
+    {
+        std::string key;
+        for (size_t node = Terminals.Select1(keyId); node != 0; node = Parent(node)) {
+            key.push_back(static_cast<char>(Label(node)));
+        }
+        std::reverse(key.begin(), key.end());
+        return key;
+    }
+
+    // Call func(key, keyId) for every key starting with prefix, in sorted order.
+    template <typename Func>
+    void ForEachWithPrefix(const std::string_view prefix, Func&& func) const
+    {
+        const size_t start = FindNode(prefix);
+        if (start == NoNode) {
+            return;
+        }
+        // Depth first walk; each frame holds the next child to visit and the end of its siblings, and
+        // a node in frame k is at depth prefix.size() + k + 1.
+        struct Frame {
+            size_t Next;
+            size_t End;
+        };
+        std::string key(prefix);
+        if (IsKey(start)) {
+            func(std::as_const(key), KeyId(start));
+        }
+        std::vector<Frame> stack;
+        const auto [first, count] = Children(start);
+        stack.push_back({ first, first + count });
+        while (!stack.empty()) {
+            if (stack.back().Next == stack.back().End) {
+                stack.pop_back();
+                continue;
+            }
+            const size_t node = stack.back().Next++;
+            key.resize(prefix.size() + stack.size() - 1);
+            key.push_back(static_cast<char>(Label(node)));
+            if (IsKey(node)) {
+                func(std::as_const(key), KeyId(node));
+            }
+            const auto [childFirst, childCount] = Children(node);
+            if (childCount != 0) {
+                stack.push_back({ childFirst, childFirst + childCount });
+            }
+        }
+    }
+
+    // Bytes held by the bit sequences, their directories and the labels.
+    size_t MemoryBytes() const {
+        return Louds.MemoryBytes() + Terminals.MemoryBytes() + (NodeCount() - 1);
+    }
+
+
+    // Serialization:
+
+
+    // Save an image that ReadFrom and MapFrom can load.
+    void WriteTo(const std::string& path) const
+    {
+        std::vector<uint64_t> image{ Magic };
+        Louds.AppendTo(image);
+        Terminals.AppendTo(image);
+        const size_t labelWords = WordsFor((NodeCount() - 1) * 8);
+        image.resize(image.size() + labelWords, 0);
+        std::memcpy(image.data() + image.size() - labelWords, Labels, NodeCount() - 1);
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size() * sizeof(uint64_t)));
+        if (!file) {
+            throw std::runtime_error("LoudsTrie could not write " + path);
+        }
+    }
+
+    // Load an image written by WriteTo into memory.
+    static LoudsTrie ReadFrom(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            throw std::runtime_error("LoudsTrie could not open " + path);
+        }
+        const size_t bytes = static_cast<size_t>(file.tellg());
+        auto image = std::make_shared<std::vector<uint64_t>>(bytes / sizeof(uint64_t));
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(image->data()), static_cast<std::streamsize>(image->size() * sizeof(uint64_t)))) {
+            throw std::runtime_error("LoudsTrie could not read " + path);
+        }
+        const uint64_t* words = image->data();
+        const size_t count = image->size();
+        return View(words, count, std::move(image));
+    }
+
+#if defined(__linux__)
+    // Map an image written by WriteTo read-only; pages are loaded on demand as queries touch them.
+    static LoudsTrie MapFrom(const std::string& path)
+    {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("LoudsTrie could not open " + path);
+        }
+        struct stat status {};
+        if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(uint64_t))) {
+            close(fd);
+            throw std::runtime_error("LoudsTrie image " + path + " is empty or unreadable");
+        }
+        const size_t bytes = static_cast<size_t>(status.st_size);
+        void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("LoudsTrie could not map " + path);
+        }
+        std::shared_ptr<const void> storage(mapping, [bytes](const void* memory) { munmap(const_cast<void*>(memory), bytes); });
+        return View(static_cast<const uint64_t*>(mapping), bytes / sizeof(uint64_t), std::move(storage));
+    }
+#endif
+
+private:
+    // Appends bits to a DynamicBitMask, doubling its width as it fills.
+    struct BitWriter {
+        void Append(const bool bit)
+        {
+            if (Length == static_cast<size_t>(Bits.Size())) {
+                if (Length == static_cast<size_t>(INT_MAX)) {
+                    throw std::length_error("LoudsTrie has more than INT_MAX bits in one sequence");
+                }
+                Bits.Resize(static_cast<int>(std::min<size_t>(std::max<size_t>(Length * 2, WordBits), INT_MAX)));
+            }
+            if (bit) {
+                Bits.SetBit(static_cast<int>(Length));
+            }
+            ++Length;
+        }
+
+        DynamicBitMask<> Finish() {
+            Bits.Resize(static_cast<int>(Length));
+            return std::move(Bits);
+        }
+
+        DynamicBitMask<> Bits;
+        size_t Length = 0;
+    };
+
+    LoudsTrie(RankSelectBits louds, RankSelectBits terminals)
+        : Louds(std::move(louds)), Terminals(std::move(terminals)) {}
+
+    // Trie over an image of count words; storage keeps the image alive.
+    static LoudsTrie View(const uint64_t* words, const size_t count, std::shared_ptr<const void> storage)
+    {
+        const uint64_t* end = words + count;
+        if (count == 0 || *words != Magic) {
+            throw std::runtime_error("LoudsTrie image has a bad header or an unknown version");
+        }
+        ++words;
+        RankSelectBits louds = RankSelectBits::View(words, end);
+        RankSelectBits terminals = RankSelectBits::View(words, end);
+        if (terminals.Size() == 0 || louds.Size() != 2 * terminals.Size() + 1 ||
+            static_cast<size_t>(end - words) < WordsFor((terminals.Size() - 1) * 8)) {
+            throw std::runtime_error("LoudsTrie image is inconsistent or truncated");
+        }
+        LoudsTrie trie(std::move(louds), std::move(terminals));
+        trie.Labels = reinterpret_cast<const uint8_t*>(words);
+        trie.Storage = std::move(storage);
+        return trie;
+    }
+
+    RankSelectBits Louds;
+    RankSelectBits Terminals;
+    std::vector<uint8_t> OwnedLabels;
+    const uint8_t* Labels = nullptr;
+    std::shared_ptr<const void> Storage;
+};
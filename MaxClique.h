@@ -0,0 +1,340 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BitMatrix.h"
+#include "DynamicBitMask.h"
+#include "Parallel.h"
+#include "WordKernels.h"
+
+/*
+MaxCliqueSolver finds a maximum clique with bit-parallel branch and bound (BBMC).
+
+-Vertices are renumbered by non-increasing degree and the BitMatrix rows permuted to match, so the
+ lowest set bit of a candidate set is its highest degree vertex.
+-A search node holds its candidate set P as a DynamicBitMask. Branching on v filters the candidates
+ with one row AND, P & Row(v), whose popcount comes from the same pass.
+-The bound is a greedy coloring of P built from masks: a color class starts as the uncolored set and
+ repeatedly takes its lowest vertex and removes that vertex's neighbors (AND-NOT of its row). Only
+ vertices whose color can still beat the best clique are branched on, highest color first.
+-Nodes are pruned when the clique plus the popcount of the candidates cannot beat the best clique,
+ before any coloring is done.
+-Searches run on WorkerCount() threads with work stealing: each worker owns a deque of subtrees,
+ pops its newest subtree and steals the oldest (largest) one of another worker when its own is empty.
+ A worker hands a branch off as a subtree only while more workers are idle than subtrees are queued,
+ so splitting follows demand at any depth. The best clique size is shared through an atomic.
+*/
+
+
+// Maximum clique and search statistics.
+struct MaxCliqueResult {
+    // Clique vertices in increasing order.
+    std::vector<int> Clique;
+    // Search nodes expanded over all workers.
+    size_t Nodes = 0;
+    // Subtrees handed to another worker.
+    size_t Steals = 0;
+};
+
+// Bit-parallel branch and bound maximum clique search.
+struct MaxCliqueSolver {
+    // Candidate sets at most this large are searched in place rather than handed off.
+    static constexpr int MinSplitCandidates = 8;
+
+    // Find a maximum clique of graph using up to `threads` workers.
+    static MaxCliqueResult Solve(const BitMatrix& graph, const unsigned threads = WorkerCount())
+    {
+        MaxCliqueResult result;
+        const int n = graph.VertexCount();
+        if (n == 0) {
+            return result;
+        }
+        MaxCliqueSolver solver(graph, std::max(threads, 1u));
+        solver.Run();
+
+        for (const int v : solver.BestClique) {
+            result.Clique.push_back(solver.Order[static_cast<size_t>(v)]);
+        }
+        std::sort(result.Clique.begin(), result.Clique.end());
+        for (const Worker& worker : solver.Workers) {
+            result.Nodes += worker.Nodes;
+            result.Steals += worker.Steals;
+        }
+        return result;
+    }
+
+private:
+    // A subtree: the clique so far and the candidates that extend it.
+    struct Task {
+        std::vector<int> Clique;
+        DynamicBitMask<> Candidates;
+    };
+
+    // Scratch masks of one search depth.
+    struct Level {
+        DynamicBitMask<> Candidates;
+        DynamicBitMask<> Uncolored;
+        DynamicBitMask<> ColorClass;
+        // Branch vertices and their colors, in coloring order.
+        std::vector<std::pair<int, int>> Branches;
+    };
+
+    struct Worker {
+        std::mutex Lock;
+        std::deque<Task> Tasks;
+        // Levels live in a deque so deeper levels can be added while shallower ones are referenced.
+        std::deque<Level> Levels;
+        std::vector<int> Clique;
+        size_t Nodes = 0;
+        size_t Steals = 0;
+    };
+
+    MaxCliqueSolver(const BitMatrix& graph, const unsigned threads)
+        : Graph(graph.VertexCount()), Order(static_cast<size_t>(graph.VertexCount())), Workers(threads)
+    {
+        const int n = graph.VertexCount();
+        std::vector<int> degree(static_cast<size_t>(n));
+        for (int v = 0; v < n; ++v) {
+            Order[static_cast<size_t>(v)] = v;
+            degree[static_cast<size_t>(v)] = graph.Degree(v);
+        }
+        std::stable_sort(Order.begin(), Order.end(), [&](int a, int b) {
+            return degree[static_cast<size_t>(a)] > degree[static_cast<size_t>(b)];
+        });
+        std::vector<int> position(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i) {
+            position[static_cast<size_t>(Order[static_cast<size_t>(i)])] = i;
+        }
+        ParallelChunks(static_cast<size_t>(n), ChunksFor(static_cast<size_t>(n), 256), [&](unsigned, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                DynamicBitMask<>& row = Graph.Rows[i];
+                graph.Row(Order[i]).ForEachSetBit([&](int u) { row.SetBit(position[static_cast<size_t>(u)]); });
+            }
+        });
+        WordCount = Graph.Rows[0].Words.size();
+    }
+
+    void Run()
+    {
+        // Seed the bound with a greedy clique: keep adding the highest degree remaining candidate.
+        DynamicBitMask<> candidates(Graph.VertexCount());
+        candidates.SetAllBits();
+        for (int v = candidates.FindNextSetBit(0); v < Graph.VertexCount(); v = candidates.FindNextSetBit(v + 1)) {
+            BestClique.push_back(v);
+            AndWords(candidates.Words.data(), Graph.Rows[static_cast<size_t>(v)].Words.data(), WordCount);
+        }
+        BestSize.store(static_cast<int>(BestClique.size()));
+
+        candidates.SetAllBits();
+        Push(Workers[0], Task{ {}, std::move(candidates) });
+        ParallelChunks(Workers.size(), static_cast<unsigned>(Workers.size()), [&](unsigned self, size_t, size_t) {
+            Work(self);
+        });
+    }
+
+    // Worker loop: run own subtrees, then stolen ones, until no subtree is queued or running.
+    // A worker that throws stops the others, so ParallelChunks can join them and rethrow.
+    void Work(const unsigned self)
+    {
+        Worker& worker = Workers[self];
+        bool idle = false;
+        for (;;) {
+            if (Stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+            Task task;
+            if (Pop(worker, task) || Steal(self, task)) {
+                if (idle) {
+                    --Idle;
+                    idle = false;
+                }
+                try {
+                    worker.Clique = std::move(task.Clique);
+                    LevelAt(worker, 0).Candidates = std::move(task.Candidates);
+                    Expand(worker, 0);
+                }
+                catch (...) {
+                    --Outstanding;
+                    Stopping.store(true);
+                    throw;
+                }
+                --Outstanding;
+                continue;
+            }
+            if (!idle) {
+                ++Idle;
+                idle = true;
+            }
+            if (Outstanding.load() == 0) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    // Search the subtree whose candidates are in worker.Levels[depth].
+    void Expand(Worker& worker, const size_t depth)
+    {
+        ++worker.Nodes;
+        Level& level = LevelAt(worker, depth);
+        uint64_t* candidates = level.Candidates.Words.data();
+        const int size = static_cast<int>(worker.Clique.size());
+        // Vertices colored at most kmin cannot beat the best clique.
+        const int kmin = BestSize.load(std::memory_order_relaxed) - size;
+        if (static_cast<int>(PopCountWords(candidates, WordCount)) <= kmin) {
+            return;
+        }
+        Color(level, kmin);
+
+        Level& child = LevelAt(worker, depth + 1);
+        for (auto branch = level.Branches.rbegin(); branch != level.Branches.rend(); ++branch) {
+            const auto [v, color] = *branch;
+            if (Stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+            if (size + color <= BestSize.load(std::memory_order_relaxed)) {
+                return;
+            }
+            std::copy(candidates, candidates + WordCount, child.Candidates.Words.data());
+            const int remaining = static_cast<int>(AndWordsPopCount(child.Candidates.Words.data(),
+                Graph.Rows[static_cast<size_t>(v)].Words.data(), WordCount));
+            worker.Clique.push_back(v);
+            if (remaining == 0) {
+                Improve(worker.Clique);
+            }
+            else if (size + 1 + remaining > BestSize.load(std::memory_order_relaxed)) {
+                if (remaining > MinSplitCandidates && Idle.load(std::memory_order_relaxed) > Queued.load(std::memory_order_relaxed)) {
+                    Push(worker, Task{ worker.Clique, child.Candidates });
+                }
+                else {
+                    Expand(worker, depth + 1);
+                }
+            }
+            worker.Clique.pop_back();
+            level.Candidates.ClearBit(v);
+        }
+    }
+
+    // Greedy sequential coloring of level.Candidates; records the vertices colored above kmin.
+    void Color(Level& level, const int kmin)
+    {
+        uint64_t* uncolored = level.Uncolored.Words.data();
+        uint64_t* colorClass = level.ColorClass.Words.data();
+        const size_t bits = WordCount * WordBits;
+        std::copy(level.Candidates.Words.begin(), level.Candidates.Words.end(), uncolored);
+        level.Branches.clear();
+        size_t first = FindNextSetWords(uncolored, WordCount, 0);
+        for (int color = 1; first < bits; ++color) {
+            const size_t from = first / WordBits;
+            std::copy(uncolored + from, uncolored + WordCount, colorClass + from);
+            // Lower bits of the class are clear: they were clear in uncolored.
+            for (size_t v = first; v < bits; v = FindNextSetWords(colorClass, WordCount, v + 1)) {
+                const size_t word = v / WordBits;
+                const uint64_t bit = uint64_t(1) << (v % WordBits);
+                uncolored[word] &= ~bit;
+                colorClass[word] &= ~bit;
+                AndNotWords(colorClass + word, Graph.Rows[v].Words.data() + word, WordCount - word);
+                if (color > kmin) {
+                    level.Branches.push_back({ static_cast<int>(v), color });
+                }
+            }
+            first = FindNextSetWords(uncolored, WordCount, first);
+        }
+    }
+
+    void Improve(const std::vector<int>& clique)
+    {
+        if (static_cast<int>(clique.size()) <= BestSize.load()) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(BestLock);
+        if (static_cast<int>(clique.size()) > BestSize.load()) {
+            BestClique = clique;
+            BestSize.store(static_cast<int>(clique.size()));
+        }
+    }
+
+    Level& LevelAt(Worker& worker, const size_t depth)
+    {
+        while (worker.Levels.size() <= depth) {
+            const int n = Graph.VertexCount();
+            worker.Levels.push_back(Level{ DynamicBitMask<>(n), DynamicBitMask<>(n), DynamicBitMask<>(n), {} });
+        }
+        return worker.Levels[depth];
+    }
+
+    void Push(Worker& worker, Task task)
+    {
+        ++Outstanding;
+        ++Queued;
+        std::lock_guard<std::mutex> guard(worker.Lock);
+        worker.Tasks.push_back(std::move(task));
+    }
+
+    // Newest own subtree: the deepest, so a worker stays close to the part of the tree it is in.
+    bool Pop(Worker& worker, Task& task)
+    {
+        std::lock_guard<std::mutex> guard(worker.Lock);
+        if (worker.Tasks.empty()) {
+            return false;
+        }
+        task = std::move(worker.Tasks.back());
+        worker.Tasks.pop_back();
+        --Queued;
+        return true;
+    }
+
+    // Oldest subtree of another worker: the shallowest, so one steal moves a large piece of work.
+    bool Steal(const unsigned self, Task& task)
+    {
+        for (size_t i = 1; i < Workers.size(); ++i) {
+            Worker& victim = Workers[(self + i) % Workers.size()];
+            std::lock_guard<std::mutex> guard(victim.Lock);
+            if (!victim.Tasks.empty()) {
+                task = std::move(victim.Tasks.front());
+                victim.Tasks.pop_front();
+                --Queued;
+                ++Workers[self].Steals;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Graph renumbered by non-increasing degree; Order maps new numbers to input vertices.
+    BitMatrix Graph;
+    std::vector<int> Order;
+    size_t WordCount = 0;
+    std::vector<Worker> Workers;
+
+    std::atomic<int> BestSize{ 0 };
+    std::mutex BestLock;
+    std::vector<int> BestClique;
+    // Subtrees queued or running, subtrees queued, and workers looking for work.
+    std::atomic<size_t> Outstanding{ 0 };
+    std::atomic<size_t> Queued{ 0 };
+    std::atomic<size_t> Idle{ 0 };
+    // Set when a worker throws; the others abandon their subtrees and return.
+    std::atomic<bool> Stopping{ false };
+};
+
+// Check that every pair of vertices is adjacent.
+inline bool IsClique(const BitMatrix& graph, const std::vector<int>& vertices)
+{
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        for (size_t j = i + 1; j < vertices.size(); ++j) {
+            if (!graph.HasEdge(vertices[i], vertices[j])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
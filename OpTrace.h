@@ -0,0 +1,477 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+OpTrace records the sequence of mask operations a program performs and replays it against any mask
+implementation, so representations and kernel changes can be compared on captured access patterns.
+
+-A trace is a header ("BMTR", version byte) followed by records of [op byte][varint target id]
+ [varint argument]. The argument is a bit position, a shift or a source mask id and is omitted for
+ operations that take none, so a typical record is 3-5 bytes.
+-TracedMask<Mask> wraps a mask, forwards every operation to it and appends a record. Masks are
+ identified by ids handed out by the trace; copies and operator results get new ids. A trace is not
+ synchronized, so record one trace per thread.
+-ReplayTrace<Mask>() decodes the trace once, then replays it twice on fresh masks: a throughput pass
+ timed as a whole and a latency pass that times each operation for percentiles. The checksum folds
+ in every query result so two implementations replaying the same trace can be checked for agreement.
+*/
+
+
+// Operations a trace can hold.
+enum class TraceOp : uint8_t {
+    Set,
+    Clear,
+    Toggle,
+    Test,
+    Count,
+    Reset,
+    Copy,       // target = source mask
+    Or,         // target += source
+    AndNot,     // target -= source
+    And,        // target &= source
+    Xor,        // target ^= source
+    Not,        // target = ~target
+    ShiftLeft,
+    ShiftRight,
+    Equal,      // target == source
+};
+
+// One decoded trace record.
+struct TraceRecord {
+    TraceOp Op;
+    uint32_t Target;
+    uint64_t Argument;
+};
+
+// A compact binary log of mask operations.
+struct OpTrace {
+    static constexpr char Magic[4] = { 'B', 'M', 'T', 'R' };
+    static constexpr uint8_t Version = 1;
+
+    OpTrace() {
+        Bytes.assign(Magic, Magic + 4);
+        Bytes.push_back(Version);
+    }
+
+
+    // Recording:
+
+
+    // Id for a newly created mask.
+    uint32_t NewMaskId() {
+        return MaskCount++;
+    }
+
+    // Append one operation.
+    void Record(const TraceOp op, const uint32_t target, const uint64_t argument = 0) {
+        Bytes.push_back(static_cast<uint8_t>(op));
+        PutVarint(target);
+        if (HasArgument(op)) {
+            PutVarint(argument);
+        }
+        ++RecordCount;
+    }
+
+    // Number of records and masks in the trace.
+    size_t Records() const {
+        return RecordCount;
+    }
+
+    uint32_t Masks() const {
+        return MaskCount;
+    }
+
+    // Encoded trace, header included.
+    const std::vector<uint8_t>& Data() const {
+        return Bytes;
+    }
+
+
+    // Files:
+
+
+    void WriteTo(const std::string& path) const {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(Bytes.data()), static_cast<std::streamsize>(Bytes.size()));
+        if (!out) {
+            throw std::runtime_error("OpTrace could not write " + path);
+        }
+    }
+
+    // Load a trace written by WriteTo, validating every record.
+    static OpTrace ReadFrom(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("OpTrace could not open " + path);
+        }
+        OpTrace trace;
+        trace.Bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        const std::vector<TraceRecord> records = trace.Decode();
+        trace.RecordCount = records.size();
+        for (const TraceRecord& record : records) {
+            trace.MaskCount = std::max(trace.MaskCount, record.Target + 1);
+            if (IsBinary(record.Op)) {
+                trace.MaskCount = std::max(trace.MaskCount, static_cast<uint32_t>(record.Argument) + 1);
+            }
+        }
+        return trace;
+    }
+
+
+    // Decoding:
+
+
+    std::vector<TraceRecord> Decode() const {
+        if (Bytes.size() < 5 || !std::equal(Magic, Magic + 4, Bytes.begin()) || Bytes[4] != Version) {
+            throw std::runtime_error("OpTrace header is missing or has an unknown version");
+        }
+        std::vector<TraceRecord> records;
+        const uint8_t* data = Bytes.data() + 5;
+        const uint8_t* end = Bytes.data() + Bytes.size();
+        while (data != end) {
+            const uint8_t op = *data++;
+            if (op > static_cast<uint8_t>(TraceOp::Equal)) {
+                throw std::runtime_error("OpTrace record has an unknown operation");
+            }
+            TraceRecord record{ static_cast<TraceOp>(op), 0, 0 };
+            const uint64_t target = GetVarint(data, end);
+            if (target > UINT32_MAX) {
+                throw std::runtime_error("OpTrace mask id is out of range");
+            }
+            record.Target = static_cast<uint32_t>(target);
+            if (HasArgument(record.Op)) {
+                record.Argument = GetVarint(data, end);
+            }
+            if (IsBinary(record.Op) && record.Argument > UINT32_MAX) {
+                throw std::runtime_error("OpTrace mask id is out of range");
+            }
+            records.push_back(record);
+        }
+        return records;
+    }
+
+    static constexpr bool HasArgument(const TraceOp op) {
+        return op != TraceOp::Count && op != TraceOp::Reset && op != TraceOp::Not;
+    }
+
+    // Operations whose argument is a second mask id.
+    static constexpr bool IsBinary(const TraceOp op) {
+        return op == TraceOp::Copy || op == TraceOp::Or || op == TraceOp::AndNot || op == TraceOp::And
+            || op == TraceOp::Xor || op == TraceOp::Equal;
+    }
+
+private:
+    void PutVarint(uint64_t value) {
+        while (value >= 0x80) {
+            Bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        Bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    static uint64_t GetVarint(const uint8_t*& data, const uint8_t* end) {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (data == end) {
+                throw std::runtime_error("OpTrace varint is truncated");
+            }
+            const uint8_t byte = *data++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("OpTrace varint is too long");
+    }
+
+    std::vector<uint8_t> Bytes;
+    size_t RecordCount = 0;
+    uint32_t MaskCount = 0;
+};
+
+
+// A mask that records every operation applied to it into an OpTrace.
+template <typename Mask>
+struct TracedMask {
+
+
+    // Constructors and Initialization:
+
+
+    // A new empty mask with its own id.
+    explicit TracedMask(OpTrace& trace) : Trace(&trace), Id(trace.NewMaskId()) {}
+
+    // Copies get a new id, recorded as a Copy from the original.
+    TracedMask(const TracedMask& other) : Value(other.Value), Trace(other.Trace), Id(other.Trace->NewMaskId())
+    {
+        Trace->Record(TraceOp::Copy, Id, other.Id);
+    }
+
+    // Moves keep the id; the moved-from mask is not used again.
+    TracedMask(TracedMask&& other) = default;
+
+    TracedMask& operator=(const TracedMask& other) {
+        if (this != &other) {
+            Value = other.Value;
+            Trace->Record(TraceOp::Copy, Id, other.Id);
+        }
+        return *this;
+    }
+
+    // Reset all bits to zero.
+    void ResetAllBits() {
+        Trace->Record(TraceOp::Reset, Id);
+        Value.ResetAllBits();
+    }
+
+
+    // Bit Manipulation Functions:
+
+
+    void SetBit(const int bitPos) {
+        Trace->Record(TraceOp::Set, Id, static_cast<uint64_t>(bitPos));
+        Value.SetBit(bitPos);
+    }
+
+    void ClearBit(const int bitPos) {
+        Trace->Record(TraceOp::Clear, Id, static_cast<uint64_t>(bitPos));
+        Value.ClearBit(bitPos);
+    }
+
+    void ToggleBit(const int bitPos) {
+        Trace->Record(TraceOp::Toggle, Id, static_cast<uint64_t>(bitPos));
+        Value.ToggleBit(bitPos);
+    }
+
+
+    // Query and Information:
+
+
+    bool IsBitSet(const int pos) const {
+        Trace->Record(TraceOp::Test, Id, static_cast<uint64_t>(pos));
+        return Value.IsBitSet(pos);
+    }
+
+    int CountSetBits() const {
+        Trace->Record(TraceOp::Count, Id);
+        return Value.CountSetBits();
+    }
+
+    // Id of this mask in the trace.
+    uint32_t TraceId() const {
+        return Id;
+    }
+
+    // The wrapped mask, for reads that should not be recorded.
+    const Mask& Untraced() const {
+        return Value;
+    }
+
+
+    // Bitwise Operations:
+
+
+    TracedMask operator+(const TracedMask& other) const {
+        TracedMask result(*this);
+        result += other;
+        return result;
+    }
+
+    TracedMask operator-(const TracedMask& other) const {
+        TracedMask result(*this);
+        result -= other;
+        return result;
+    }
+
+    TracedMask operator&(const TracedMask& other) const {
+        TracedMask result(*this);
+        result &= other;
+        return result;
+    }
+
+    TracedMask operator^(const TracedMask& other) const {
+        TracedMask result(*this);
+        result ^= other;
+        return result;
+    }
+
+    TracedMask& operator+=(const TracedMask& other) {
+        Trace->Record(TraceOp::Or, Id, other.Id);
+        Value += other.Value;
+        return *this;
+    }
+
+    TracedMask& operator-=(const TracedMask& other) {
+        Trace->Record(TraceOp::AndNot, Id, other.Id);
+        Value -= other.Value;
+        return *this;
+    }
+
+    TracedMask& operator&=(const TracedMask& other) {
+        Trace->Record(TraceOp::And, Id, other.Id);
+        ApplyAnd(Value, other.Value);
+        return *this;
+    }
+
+    TracedMask& operator^=(const TracedMask& other) {
+        Trace->Record(TraceOp::Xor, Id, other.Id);
+        Value ^= other.Value;
+        return *this;
+    }
+
+    TracedMask operator~() const {
+        TracedMask result(*this);
+        Trace->Record(TraceOp::Not, result.Id);
+        result.Value = ~result.Value;
+        return result;
+    }
+
+    TracedMask operator<<(int shift) const {
+        TracedMask result(*this);
+        result <<= shift;
+        return result;
+    }
+
+    TracedMask operator>>(int shift) const {
+        TracedMask result(*this);
+        result >>= shift;
+        return result;
+    }
+
+    TracedMask& operator<<=(int shift) {
+        Trace->Record(TraceOp::ShiftLeft, Id, static_cast<uint64_t>(shift));
+        Value <<= shift;
+        return *this;
+    }
+
+    TracedMask& operator>>=(int shift) {
+        Trace->Record(TraceOp::ShiftRight, Id, static_cast<uint64_t>(shift));
+        Value >>= shift;
+        return *this;
+    }
+
+    bool operator==(const TracedMask& other) const {
+        Trace->Record(TraceOp::Equal, Id, other.Id);
+        return Value == other.Value;
+    }
+
+    bool operator!=(const TracedMask& other) const {
+        return !(*this == other);
+    }
+
+    // target &= source, or target -= (target - source) for masks without &=, such as BitMaskBase.
+    static void ApplyAnd(Mask& target, const Mask& source) {
+        if constexpr (requires { target &= source; }) {
+            target &= source;
+        }
+        else {
+            target -= (target - source);
+        }
+    }
+
+private:
+    Mask Value;
+    OpTrace* Trace;
+    uint32_t Id;
+};
+
+
+// Results of replaying a trace.
+struct ReplayStats {
+    size_t Operations = 0;
+    double Seconds = 0;
+    double OpsPerSecond = 0;
+    // Per-operation latency percentiles in nanoseconds; they include the cost of reading the clock.
+    double P50Nanoseconds = 0;
+    double P90Nanoseconds = 0;
+    double P99Nanoseconds = 0;
+    double MaxNanoseconds = 0;
+    // Sum of every query result, equal across implementations that agree on the trace.
+    uint64_t Checksum = 0;
+};
+
+// Apply one record to masks, folding query results into checksum.
+template <typename Mask>
+void ApplyTraceRecord(std::vector<Mask>& masks, const TraceRecord& record, uint64_t& checksum)
+{
+    Mask& target = masks[record.Target];
+    const int pos = static_cast<int>(record.Argument);
+    switch (record.Op) {
+    case TraceOp::Set: target.SetBit(pos); break;
+    case TraceOp::Clear: target.ClearBit(pos); break;
+    case TraceOp::Toggle: target.ToggleBit(pos); break;
+    case TraceOp::Test: checksum += target.IsBitSet(pos) ? 1 : 0; break;
+    case TraceOp::Count: checksum += static_cast<uint64_t>(target.CountSetBits()); break;
+    case TraceOp::Reset: target.ResetAllBits(); break;
+    case TraceOp::Copy: target = masks[record.Argument]; break;
+    case TraceOp::Or: target += masks[record.Argument]; break;
+    case TraceOp::AndNot: target -= masks[record.Argument]; break;
+    case TraceOp::And: TracedMask<Mask>::ApplyAnd(target, masks[record.Argument]); break;
+    case TraceOp::Xor: target ^= masks[record.Argument]; break;
+    case TraceOp::Not: target = ~target; break;
+    case TraceOp::ShiftLeft: target <<= pos; break;
+    case TraceOp::ShiftRight: target >>= pos; break;
+    case TraceOp::Equal: checksum += target == masks[record.Argument] ? 1 : 0; break;
+    }
+}
+
+// Re-execute a trace against Mask and measure throughput and per-operation latency.
+template <typename Mask>
+ReplayStats ReplayTrace(const OpTrace& trace)
+{
+    const std::vector<TraceRecord> records = trace.Decode();
+    uint32_t maskCount = trace.Masks();
+    for (const TraceRecord& record : records) {
+        maskCount = std::max(maskCount, record.Target + 1);
+        if (OpTrace::IsBinary(record.Op)) {
+            maskCount = std::max(maskCount, static_cast<uint32_t>(record.Argument) + 1);
+        }
+    }
+
+    ReplayStats stats;
+    stats.Operations = records.size();
+
+    // Throughput pass: one clock read around the whole replay.
+    {
+        std::vector<Mask> masks(maskCount);
+        uint64_t checksum = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (const TraceRecord& record : records) {
+            ApplyTraceRecord(masks, record, checksum);
+        }
+        stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats.OpsPerSecond = stats.Seconds > 0 ? static_cast<double>(records.size()) / stats.Seconds : 0;
+        stats.Checksum = checksum;
+    }
+
+    // Latency pass: every operation timed on its own.
+    if (!records.empty()) {
+        std::vector<Mask> masks(maskCount);
+        std::vector<double> latencies;
+        latencies.reserve(records.size());
+        uint64_t checksum = 0;
+        for (const TraceRecord& record : records) {
+            const auto start = std::chrono::steady_clock::now();
+            ApplyTraceRecord(masks, record, checksum);
+            latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        const auto percentile = [&](double fraction) {
+            return latencies[std::min(latencies.size() - 1, static_cast<size_t>(fraction * static_cast<double>(latencies.size())))];
+        };
+        stats.P50Nanoseconds = percentile(0.50);
+        stats.P90Nanoseconds = percentile(0.90);
+        stats.P99Nanoseconds = percentile(0.99);
+        stats.MaxNanoseconds = latencies.back();
+    }
+    return stats;
+}
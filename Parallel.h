@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Number of worker threads the parallel kernels split their work across.
+inline unsigned WorkerCount()
+{
+    const unsigned hw = std::thread::hardware_concurrency();
+    return hw != 0 ? hw : 1;
+}
+
+// Split [0, count) into at most `chunks` contiguous ranges and call body(chunk, begin, end) for each.
+// Chunk 0 runs on the calling thread, the rest on short-lived worker threads. Ranges never overlap,
+// so the body only needs synchronization for state shared between chunks. An exception thrown by a
+// body is rethrown on the calling thread once every chunk has finished (the lowest chunk's wins).
+// If a worker thread cannot be started, its chunk and the later ones run on the calling thread.
+template <typename Body>
+void ParallelChunks(size_t count, unsigned chunks, Body&& body)
+{
+    if (count == 0) {
+        return;
+    }
+    chunks = static_cast<unsigned>(std::min<size_t>(std::max(chunks, 1u), count));
+    const size_t perChunk = (count + chunks - 1) / chunks;
+
+    std::vector<std::exception_ptr> errors(chunks);
+    const auto run = [&body, &errors, count, perChunk](const unsigned chunk) {
+        const size_t begin = chunk * perChunk;
+        const size_t end = std::min(count, begin + perChunk);
+        if (begin >= end) {
+            return;
+        }
+        try {
+            body(chunk, begin, end);
+        }
+        catch (...) {
+            errors[chunk] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    // Chunks whose thread could not be started run on the calling thread after chunk 0.
+    unsigned spawned = 1;
+    for (; spawned < chunks; ++spawned) {
+        try {
+            workers.emplace_back(run, spawned);
+        }
+        catch (...) {
+            break;
+        }
+    }
+    run(0);
+    for (unsigned chunk = spawned; chunk < chunks; ++chunk) {
+        run(chunk);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+// Number of chunks worth using for `count` items when each chunk should cover at least `minPerChunk`.
+inline unsigned ChunksFor(size_t count, size_t minPerChunk)
+{
+    const size_t wanted = minPerChunk != 0 ? count / minPerChunk : count;
+    return static_cast<unsigned>(std::clamp<size_t>(wanted, 1, WorkerCount()));
+}
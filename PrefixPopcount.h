@@ -0,0 +1,162 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "Bitmask.h"
+#include "Parallel.h"
+
+/*
+Prefix popcount and stream compaction over arrays of masks.
+
+-PrefixPopcount writes, for every element of a mask array, the exclusive prefix sum of the set-bit
+ counts before it. That is the output offset of the element's selected values in a compacted stream.
+-CompactByMask scatters the values selected by a mask array into a dense output.
+
+Both accept raw unsigned words (uint8_t ... uint64_t, e.g. the words of a wide mask) or any
+BitMask / Enummask. Element i of the mask array covers values [i * bits, (i + 1) * bits), where bits
+is the word width for raw words and TMax for BitMaskBase types.
+
+The scan is a two-pass blocked scan: each worker counts its block (a tight popcount loop the compiler
+vectorizes), the block totals are scanned serially, then each worker writes its block's offsets.
+*/
+
+
+// Mask word helpers:
+
+
+// Number of usable bits in a raw unsigned mask word.
+template <typename Word, std::enable_if_t<std::is_integral_v<Word>, int> = 0>
+constexpr int MaskWordBits(const Word*)
+{
+    return std::numeric_limits<std::make_unsigned_t<Word>>::digits;
+}
+
+// Number of usable bits in a BitMaskBase, which is its TMax.
+template <typename MaskType, typename OpType, int TMax, typename CheckPolicy>
+constexpr int MaskWordBits(const BitMaskBase<MaskType, OpType, TMax, CheckPolicy>*)
+{
+    return TMax;
+}
+
+// Value of a raw unsigned mask word as 64 bits.
+template <typename Word, std::enable_if_t<std::is_integral_v<Word>, int> = 0>
+constexpr uint64_t MaskWordValue(const Word word)
+{
+    return static_cast<uint64_t>(static_cast<std::make_unsigned_t<Word>>(word));
+}
+
+// Value of a BitMaskBase as 64 bits, with the bits at or above TMax dropped.
+template <typename MaskType, typename OpType, int TMax, typename CheckPolicy>
+constexpr uint64_t MaskWordValue(const BitMaskBase<MaskType, OpType, TMax, CheckPolicy>& mask)
+{
+    const uint64_t value = static_cast<uint64_t>(static_cast<std::make_unsigned_t<MaskType>>(mask.Mask));
+    return TMax >= 64 ? value : value & ((uint64_t(1) << TMax) - 1);
+}
+
+// Number of set bits in a mask word.
+template <typename Word>
+constexpr int PopCountOf(const Word& word)
+{
+    return std::popcount(MaskWordValue(word));
+}
+
+
+// Prefix Popcount:
+
+
+// Minimum number of mask words a worker is given before the scan goes parallel.
+constexpr size_t PrefixPopcountBlock = size_t(1) << 14;
+
+// Write the exclusive prefix sum of PopCountOf(words[i]) into offsets[i] and return the total count.
+template <typename Word>
+size_t PrefixPopcount(const Word* words, size_t count, size_t* offsets)
+{
+    const unsigned chunks = ChunksFor(count, PrefixPopcountBlock);
+    std::vector<size_t> blockTotals(chunks + 1, 0);
+
+    // Pass 1: per-element popcounts and block totals.
+    ParallelChunks(count, chunks, [&](unsigned chunk, size_t begin, size_t end) {
+        size_t total = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const size_t bits = static_cast<size_t>(PopCountOf(words[i]));
+            offsets[i] = bits;
+            total += bits;
+        }
+        blockTotals[chunk + 1] = total;
+    });
+
+    for (unsigned chunk = 0; chunk < chunks; ++chunk) {
+        blockTotals[chunk + 1] += blockTotals[chunk];
+    }
+
+    // Pass 2: turn the counts into offsets, seeded by the block's starting total.
+    ParallelChunks(count, chunks, [&](unsigned chunk, size_t begin, size_t end) {
+        size_t running = blockTotals[chunk];
+        for (size_t i = begin; i < end; ++i) {
+            const size_t bits = offsets[i];
+            offsets[i] = running;
+            running += bits;
+        }
+    });
+
+    return blockTotals[chunks];
+}
+
+// Convenience overload returning the offsets.
+template <typename Word>
+std::vector<size_t> PrefixPopcount(const std::vector<Word>& words)
+{
+    std::vector<size_t> offsets(words.size());
+    PrefixPopcount(words.data(), words.size(), offsets.data());
+    return offsets;
+}
+
+
+// Compaction:
+
+
+// Scatter the selected values into out, given the offsets PrefixPopcount produced for `select`.
+template <typename T, typename Word>
+void ScatterByMask(const T* values, const Word* select, const size_t* offsets, size_t wordCount, T* out)
+{
+    constexpr size_t bitsPerWord = static_cast<size_t>(MaskWordBits(static_cast<const Word*>(nullptr)));
+    static_assert(bitsPerWord <= 64, "CompactByMask supports mask words of up to 64 bits");
+
+    ParallelChunks(wordCount, ChunksFor(wordCount, PrefixPopcountBlock), [&](unsigned, size_t begin, size_t end) {
+        for (size_t w = begin; w < end; ++w) {
+            uint64_t bits = MaskWordValue(select[w]);
+            T* dst = out + offsets[w];
+            const T* src = values + w * bitsPerWord;
+            while (bits != 0) {
+                *dst++ = src[std::countr_zero(bits)];
+                bits &= bits - 1;
+            }
+        }
+    });
+}
+
+// Copy every values[i] whose selection bit is set into out, in order, and return how many were copied.
+// `values` must hold MaskWordBits * wordCount elements; out must have room for the selected ones.
+template <typename T, typename Word>
+size_t CompactByMask(const T* values, const Word* select, size_t wordCount, T* out)
+{
+    std::vector<size_t> offsets(wordCount);
+    const size_t total = PrefixPopcount(select, wordCount, offsets.data());
+    ScatterByMask(values, select, offsets.data(), wordCount, out);
+    return total;
+}
+
+// Convenience overload; values.size() must be at least MaskWordBits * select.size().
+template <typename T, typename Word>
+std::vector<T> CompactByMask(const std::vector<T>& values, const std::vector<Word>& select)
+{
+    std::vector<size_t> offsets(select.size());
+    std::vector<T> out(PrefixPopcount(select.data(), select.size(), offsets.data()));
+    ScatterByMask(values.data(), select.data(), offsets.data(), select.size(), out.data());
+    return out;
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "DynamicBitMask.h"
+#include "WordKernels.h"
+
+/*
+RankSelectBits answers rank and select queries over a static bit sequence, for succinct structures
+(LOUDS tries, wavelet matrices) that navigate by counting bits.
+
+-Rank1(pos) counts the set bits before pos: a cumulative count per 512 bit block, then at most 8 word
+ popcounts. Rank0 is pos - Rank1.
+-Select1(k) / Select0(k) find the position of the k-th (0-based) set / clear bit. Every 512th one and
+ zero records its block, which narrows a binary search over the block counts; the last word is
+ resolved with SelectInWord.
+-The directory costs 1/8 of the bits for block counts plus about 1/256 for select samples.
+-The sequence is built from a DynamicBitMask and owned by the index, or viewed in place from a
+ serialized image (AppendTo / View), so a memory-mapped file needs no copy and no rebuild. Images
+ are native endian words.
+*/
+
+
+// Static bit sequence with constant time rank and fast select.
+struct RankSelectBits {
+    static constexpr size_t BlockBits = 512;
+    static constexpr size_t WordsPerBlock = BlockBits / WordBits;
+    static constexpr size_t SampleRate = 512;
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor creates an empty sequence.
+    RankSelectBits() = default;
+
+    // Index bits, taking ownership of its words.
+    explicit RankSelectBits(DynamicBitMask<> bits)
+        : OwnedBits(std::move(bits)), Words(OwnedBits.Words.data()), BitCount(static_cast<size_t>(OwnedBits.Size()))
+    {
+        const size_t blocks = BlockCount();
+        OwnedRanks.resize(blocks + 1);
+        size_t ones = 0;
+        for (size_t block = 0; block < blocks; ++block) {
+            OwnedRanks[block] = ones;
+            const size_t first = block * WordsPerBlock;
+            ones += PopCountWords(Words + first, std::min(WordsPerBlock, WordCount() - first));
+        }
+        OwnedRanks[blocks] = ones;
+        OneCount = ones;
+        Ranks = OwnedRanks.data();
+
+        // Sample the block of every SampleRate-th one and zero.
+        for (size_t block = 0, nextOne = 0, nextZero = 0; block < blocks; ++block) {
+            const size_t onesAfter = Ranks[block + 1];
+            const size_t zerosAfter = std::min((block + 1) * BlockBits, BitCount) - onesAfter;
+            for (; nextOne < onesAfter; nextOne += SampleRate) {
+                OwnedSelect1.push_back(block);
+            }
+            for (; nextZero < zerosAfter; nextZero += SampleRate) {
+                OwnedSelect0.push_back(block);
+            }
+        }
+        Select1Samples = OwnedSelect1.data();
+        Select0Samples = OwnedSelect0.data();
+    }
+
+    // The words' buffers move with their vectors, so the views stay valid; copies would not.
+    RankSelectBits(RankSelectBits&&) noexcept = default;
+    RankSelectBits& operator=(RankSelectBits&&) noexcept = default;
+    RankSelectBits(const RankSelectBits&) = delete;
+    RankSelectBits& operator=(const RankSelectBits&) = delete;
+
+
+    // Query and Information:
+
+
+    // Number of bits in the sequence.
+    size_t Size() const {
+        return BitCount;
+    }
+
+    size_t Ones() const {
+        return OneCount;
+    }
+
+    size_t Zeros() const {
+        return BitCount - OneCount;
+    }
+
+    bool IsBitSet(const size_t pos) const {
+        return ((Words[pos / WordBits] >> (pos % WordBits)) & 1) != 0;
+    }
+
+    // Raw words of the sequence.
+    const uint64_t* Data() const {
+        return Words;
+    }
+
+    // Number of set bits before pos, for pos in [0, Size()].
+    size_t Rank1(const size_t pos) const
+    {
+        const size_t block = pos / BlockBits;
+        const size_t word = pos / WordBits;
+        size_t rank = Ranks[block] + PopCountWords(Words + block * WordsPerBlock, word - block * WordsPerBlock);
+        if (pos % WordBits != 0) {
+            rank += static_cast<size_t>(std::popcount(Words[word] & ((uint64_t(1) << (pos % WordBits)) - 1)));
+        }
+        return rank;
+    }
+
+    // Number of clear bits before pos, for pos in [0, Size()].
+    size_t Rank0(const size_t pos) const {
+        return pos - Rank1(pos);
+    }
+
+    // Position of the set bit with k set bits before it, for k < Ones().
+    size_t Select1(const size_t k) const
+    {
+        size_t block = FindBlock(k, Select1Samples, (OneCount + SampleRate - 1) / SampleRate,
+            [&](size_t b) { return Ranks[b]; });
+        size_t rest = k - Ranks[block];
+        for (size_t word = block * WordsPerBlock;; ++word) {
+            const size_t count = static_cast<size_t>(std::popcount(Words[word]));
+            if (rest < count) {
+                return word * WordBits + static_cast<size_t>(SelectInWord(Words[word], static_cast<unsigned>(rest)));
+            }
+            rest -= count;
+        }
+    }
+
+    // Position of the clear bit with k clear bits before it, for k < Zeros().
+    size_t Select0(const size_t k) const
+    {
+        size_t block = FindBlock(k, Select0Samples, (Zeros() + SampleRate - 1) / SampleRate,
+            [&](size_t b) { return b * BlockBits - Ranks[b]; });
+        size_t rest = k - (block * BlockBits - Ranks[block]);
+        for (size_t word = block * WordsPerBlock;; ++word) {
+            const uint64_t zeros = ~Words[word];
+            const size_t count = static_cast<size_t>(std::popcount(zeros));
+            if (rest < count) {
+                return word * WordBits + static_cast<size_t>(SelectInWord(zeros, static_cast<unsigned>(rest)));
+            }
+            rest -= count;
+        }
+    }
+
+    // Bytes held by the bits and the directory.
+    size_t MemoryBytes() const {
+        return (WordCount() + BlockCount() + 1 + SampleCount()) * sizeof(uint64_t);
+    }
+
+
+    // Serialization:
+
+
+    // Append the sequence and its directory to image as words.
+    void AppendTo(std::vector<uint64_t>& image) const
+    {
+        image.push_back(BitCount);
+        image.push_back(OneCount);
+        image.insert(image.end(), Words, Words + WordCount());
+        image.insert(image.end(), Ranks, Ranks + BlockCount() + 1);
+        const size_t ones = (OneCount + SampleRate - 1) / SampleRate;
+        image.insert(image.end(), Select1Samples, Select1Samples + ones);
+        image.insert(image.end(), Select0Samples, Select0Samples + (SampleCount() - ones));
+    }
+
+    // View a sequence written by AppendTo at cursor, advancing cursor past it. The image must outlive
+    // the view.
+    static RankSelectBits View(const uint64_t*& cursor, const uint64_t* end)
+    {
+        RankSelectBits result;
+        if (end - cursor < 2) {
+            throw std::runtime_error("RankSelectBits image is truncated");
+        }
+        result.BitCount = static_cast<size_t>(cursor[0]);
+        result.OneCount = static_cast<size_t>(cursor[1]);
+        if (result.OneCount > result.BitCount) {
+            throw std::runtime_error("RankSelectBits image has more ones than bits");
+        }
+        const size_t ones = (result.OneCount + SampleRate - 1) / SampleRate;
+        const size_t words = result.WordCount() + result.BlockCount() + 1 + result.SampleCount();
+        if (static_cast<size_t>(end - cursor - 2) < words) {
+            throw std::runtime_error("RankSelectBits image is truncated");
+        }
+        result.Words = cursor + 2;
+        result.Ranks = result.Words + result.WordCount();
+        result.Select1Samples = result.Ranks + result.BlockCount() + 1;
+        result.Select0Samples = result.Select1Samples + ones;
+        cursor += 2 + words;
+        return result;
+    }
+
+private:
+    size_t WordCount() const {
+        return WordsFor(BitCount);
+    }
+
+    size_t BlockCount() const {
+        return (BitCount + BlockBits - 1) / BlockBits;
+    }
+
+    size_t SampleCount() const {
+        return (OneCount + SampleRate - 1) / SampleRate + (Zeros() + SampleRate - 1) / SampleRate;
+    }
+
+    // Last block whose count of preceding bits (countBefore) is at most k, searching between the
+    // samples around k.
+    template <typename CountBefore>
+    size_t FindBlock(const size_t k, const uint64_t* samples, const size_t sampleCount, CountBefore&& countBefore) const
+    {
+        const size_t sample = k / SampleRate;
+        size_t low = static_cast<size_t>(samples[sample]);
+        size_t high = sample + 1 < sampleCount ? static_cast<size_t>(samples[sample + 1]) + 1 : BlockCount();
+        while (high - low > 1) {
+            const size_t middle = low + (high - low) / 2;
+            if (countBefore(middle) <= k) {
+                low = middle;
+            }
+            else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    DynamicBitMask<> OwnedBits;
+    std::vector<uint64_t> OwnedRanks;
+    std::vector<uint64_t> OwnedSelect1;
+    std::vector<uint64_t> OwnedSelect0;
+    const uint64_t* Words = nullptr;
+    const uint64_t* Ranks = nullptr;
+    const uint64_t* Select1Samples = nullptr;
+    const uint64_t* Select0Samples = nullptr;
+    size_t BitCount = 0;
+    size_t OneCount = 0;
+};
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "ChunkedBitmap.h"
+#include "Parallel.h"
+#include "SpscQueue.h"
+
+/*
+SeenSet performs exact, multi-threaded deduplication of a stream of 32- or 64-bit ids.
+
+-Each id is routed by its top PartitionBits bits to one of 2^PartitionBits partitions. Every
+ partition owns a ChunkedBitmap and a worker thread, so partitions never share state.
+-Producers are single-threaded handles that buffer ids per partition and hand full batches to the
+ partition worker through a lock-free SPSC queue (one queue per producer and partition).
+-Workers report ids seen for the first time through an optional callback, and keep a running count.
+-An idle worker spins briefly, then blocks on its partition's push counter (std::atomic::wait); every
+ sent batch and Finish() bump the counter and wake it, so an idle SeenSet does not burn cores.
+-Finish() drains the queues and stops the workers; after it, Contains and Merge can be used.
+*/
+
+
+// Exact deduplication of streaming ids over partitioned bitmaps.
+template <typename IdType>
+struct SeenSet {
+    static_assert(std::is_same_v<IdType, uint32_t> || std::is_same_v<IdType, uint64_t>, "SeenSet supports uint32_t and uint64_t ids");
+
+    static constexpr int IdBits = static_cast<int>(sizeof(IdType) * 8);
+    static constexpr size_t BatchSize = 256;
+    static constexpr size_t QueueBatches = 64;
+    // Empty passes over its queues a worker makes, yielding in between, before it blocks.
+    static constexpr unsigned IdleSpins = 64;
+
+    // A fixed size group of ids travelling from a producer to one partition.
+    struct Batch {
+        uint32_t Count = 0;
+        IdType Ids[BatchSize];
+    };
+
+    // Called on a partition worker with the ids of one batch that had not been seen before.
+    using NewIdsCallback = std::function<void(unsigned partition, const IdType* ids, size_t count)>;
+
+    // Per-thread insertion handle; each producer must be used from a single thread.
+    struct Producer {
+        // Queue id for deduplication, sending the partition's batch once it is full.
+        void Insert(const IdType id)
+        {
+            const unsigned partition = Owner->PartitionOf(id);
+            Batch& batch = Pending[partition];
+            batch.Ids[batch.Count++] = id;
+            if (batch.Count == BatchSize) {
+                Send(partition);
+            }
+        }
+
+        // Queue a run of ids.
+        void InsertBatch(const IdType* ids, const size_t count)
+        {
+            for (size_t i = 0; i < count; ++i) {
+                Insert(ids[i]);
+            }
+        }
+
+        // Send every partially filled batch.
+        void Flush()
+        {
+            for (unsigned partition = 0; partition < Pending.size(); ++partition) {
+                if (Pending[partition].Count != 0) {
+                    Send(partition);
+                }
+            }
+        }
+
+    private:
+        friend struct SeenSet;
+
+        void Send(const unsigned partition)
+        {
+            SpscQueue<Batch>& queue = *Owner->Partitions[partition]->Queues[Index];
+            while (!queue.TryPush(Pending[partition])) {
+                std::this_thread::yield();
+            }
+            Pending[partition].Count = 0;
+            Owner->Partitions[partition]->Wake();
+        }
+
+        SeenSet* Owner = nullptr;
+        unsigned Index = 0;
+        std::vector<Batch> Pending;
+    };
+
+
+    // Constructors and Initialization:
+
+
+    // Start 2^partitionBits partition workers fed by producerCount producers.
+    // partitionBits must be below 32 and at most the id width.
+    SeenSet(const unsigned partitionBits, const unsigned producerCount, NewIdsCallback onNewIds = {})
+        : PartitionBits(CheckedPartitionBits(partitionBits)), OnNewIds(std::move(onNewIds))
+    {
+        const unsigned partitions = 1u << partitionBits;
+        Producers.resize(producerCount);
+        for (unsigned i = 0; i < producerCount; ++i) {
+            Producers[i].Owner = this;
+            Producers[i].Index = i;
+            Producers[i].Pending.resize(partitions);
+        }
+        for (unsigned p = 0; p < partitions; ++p) {
+            auto partition = std::make_unique<Partition>();
+            for (unsigned i = 0; i < producerCount; ++i) {
+                partition->Queues.push_back(std::make_unique<SpscQueue<Batch>>(QueueBatches));
+            }
+            Partitions.push_back(std::move(partition));
+        }
+        for (unsigned p = 0; p < partitions; ++p) {
+            Partitions[p]->Worker = std::thread([this, p] { RunWorker(p); });
+        }
+    }
+
+    SeenSet(const SeenSet&) = delete;
+    SeenSet& operator=(const SeenSet&) = delete;
+
+    ~SeenSet() {
+        Finish();
+    }
+
+    // Handle for producer thread index.
+    Producer& GetProducer(const unsigned index) {
+        return Producers[index];
+    }
+
+    // Flush every producer, wait until all queued ids are deduplicated and stop the workers.
+    // Producers must no longer be in use by their threads.
+    void Finish()
+    {
+        if (Finished) {
+            return;
+        }
+        Finished = true;
+        // Flush before publishing the stop request so the workers see every batch.
+        for (Producer& producer : Producers) {
+            producer.Flush();
+        }
+        Stopping.store(true, std::memory_order_release);
+        for (auto& partition : Partitions) {
+            partition->Wake();
+        }
+        for (auto& partition : Partitions) {
+            if (partition->Worker.joinable()) {
+                partition->Worker.join();
+            }
+        }
+    }
+
+
+    // Query and Information:
+
+
+    // Partition that owns id.
+    unsigned PartitionOf(const IdType id) const {
+        return PartitionBits == 0 ? 0u : static_cast<unsigned>(id >> (IdBits - PartitionBits));
+    }
+
+    // Number of distinct ids processed so far; exact once Finish has returned.
+    size_t Cardinality() const {
+        size_t total = 0;
+        for (const auto& partition : Partitions) {
+            total += partition->Count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // Check if id has been seen; only valid after Finish.
+    bool Contains(const IdType id) const {
+        return Partitions[PartitionOf(id)]->Bits.IsBitSet(id);
+    }
+
+    // Bitmap of one partition; only valid after Finish.
+    const ChunkedBitmap& PartitionBitmap(const unsigned partition) const {
+        return Partitions[partition]->Bits;
+    }
+
+    // Merge the ids of another finished SeenSet with the same partitioning, one thread per partition.
+    void Merge(const SeenSet& other)
+    {
+        if (other.Partitions.size() != Partitions.size()) {
+            throw std::invalid_argument("SeenSet::Merge needs a SeenSet with the same number of partitions");
+        }
+        ParallelChunks(Partitions.size(), WorkerCount(), [&](unsigned, size_t begin, size_t end) {
+            for (size_t p = begin; p < end; ++p) {
+                Partition& partition = *Partitions[p];
+                partition.Bits.Merge(other.Partitions[p]->Bits);
+                partition.Count.store(partition.Bits.CountSetBits(), std::memory_order_relaxed);
+            }
+        });
+    }
+
+private:
+    struct Partition {
+        ChunkedBitmap Bits;
+        std::vector<std::unique_ptr<SpscQueue<Batch>>> Queues;
+        std::atomic<size_t> Count{ 0 };
+        // Bumped after every push and on Finish; the worker sleeps on it while idle.
+        std::atomic<uint32_t> Pushes{ 0 };
+        std::thread Worker;
+
+        void Wake() {
+            Pushes.fetch_add(1, std::memory_order_release);
+            Pushes.notify_one();
+        }
+    };
+
+    static unsigned CheckedPartitionBits(const unsigned partitionBits)
+    {
+        if (partitionBits >= 32 || partitionBits > static_cast<unsigned>(IdBits)) {
+            throw std::invalid_argument("SeenSet partitionBits must be below 32 and at most the id width");
+        }
+        return partitionBits;
+    }
+
+    // Drain the partition's queues until Finish has been requested and they are empty.
+    void RunWorker(const unsigned index)
+    {
+        Partition& partition = *Partitions[index];
+        std::vector<IdType> fresh;
+        fresh.reserve(BatchSize);
+        Batch batch;
+        bool sawStop = false;
+        unsigned idlePasses = 0;
+
+        while (true) {
+            // Read before the pass, so a push that the pass misses changes it and the wait returns.
+            const uint32_t pushes = partition.Pushes.load(std::memory_order_acquire);
+            bool idle = true;
+            for (auto& queue : partition.Queues) {
+                while (queue->TryPop(batch)) {
+                    idle = false;
+                    fresh.clear();
+                    for (uint32_t i = 0; i < batch.Count; ++i) {
+                        if (partition.Bits.Insert(batch.Ids[i])) {
+                            fresh.push_back(batch.Ids[i]);
+                        }
+                    }
+                    partition.Count.fetch_add(fresh.size(), std::memory_order_relaxed);
+                    if (OnNewIds && !fresh.empty()) {
+                        OnNewIds(index, fresh.data(), fresh.size());
+                    }
+                }
+            }
+            if (!idle) {
+                idlePasses = 0;
+                continue;
+            }
+            // Every push happened before the stop request, so one empty pass after seeing it is final.
+            if (sawStop) {
+                break;
+            }
+            sawStop = Stopping.load(std::memory_order_acquire);
+            if (sawStop) {
+                continue;
+            }
+            if (++idlePasses < IdleSpins) {
+                std::this_thread::yield();
+            }
+            else {
+                partition.Pushes.wait(pushes, std::memory_order_acquire);
+            }
+        }
+    }
+
+    unsigned PartitionBits;
+    NewIdsCallback OnNewIds;
+    std::vector<Producer> Producers;
+    std::vector<std::unique_ptr<Partition>> Partitions;
+    std::atomic<bool> Stopping{ false };
+    bool Finished = false;
+};
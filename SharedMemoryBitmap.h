@@ -0,0 +1,379 @@
+#pragma once
+
+// POSIX shared memory and futexes are Linux only; other platforms get no SharedMemoryBitmap.
+#if defined(__linux__)
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Bitmask.h"
+#include "WordKernels.h"
+
+/*
+SharedMemoryBitmap is a bitmap that several processes on one host map and update concurrently.
+
+-Create() makes a named POSIX shared memory object (shm_open + mmap); Open() attaches to it and
+ validates the versioned header, so a process built against a different layout refuses to attach.
+-SetBit, ClearBit and TestAndSet are single atomic RMWs on the shared words; ClaimFirstClear finds a
+ clear bit and claims it with a CAS, which makes it usable for slot ownership.
+-WaitForBit sleeps on a futex in the header until another process changes the bit. Writers only make
+ the wake syscall when some process is actually waiting.
+-Bit positions go through the CheckPolicy before the mapping is touched. The default is
+ BitCheck::Throw: a stray position would otherwise write past the mapping or into the bits another
+ process owns. With BitCheck::Saturate out of range writes are skipped, TestAndSet reports the bit as
+ taken and IsBitSet / WaitForBit return false.
+*/
+
+
+// Layout header at the start of the shared mapping. Version must change whenever this struct or the
+// word layout changes.
+struct SharedBitmapHeader {
+    static constexpr uint32_t ExpectedMagic = 0x48534D42; // "BMSH"
+    static constexpr uint32_t CurrentVersion = 1;
+
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t HeaderSize;
+    uint32_t WordOffset;
+    uint64_t BitCount;
+    std::atomic<uint32_t> Ready;
+    std::atomic<uint32_t> Waiters;
+    // Futex word; bumped on every change while there are waiters.
+    std::atomic<uint32_t> Sequence;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared words must be lock-free to be address-free");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared header fields must be lock-free to be address-free");
+
+
+// A named bitmap in POSIX shared memory with atomic, cross-process bit operations.
+template <typename CheckPolicy = BitCheck::Throw>
+struct SharedMemoryBitmap {
+    static constexpr size_t WordOffset = 64;
+
+
+    // Constructors and Initialization:
+
+
+    // Create a new shared bitmap of bitCount bits; fails if the name already exists.
+    static SharedMemoryBitmap Create(const std::string& name, const uint64_t bitCount)
+    {
+        const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            ThrowErrno("shm_open(create) " + name);
+        }
+        const size_t bytes = WordOffset + WordsFor(bitCount) * sizeof(uint64_t);
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            const int error = errno;
+            close(fd);
+            shm_unlink(name.c_str());
+            errno = error;
+            ThrowErrno("ftruncate " + name);
+        }
+        // A failed mmap must not leave the name behind, or every retry fails with EEXIST.
+        SharedMemoryBitmap bitmap = [&] {
+            try {
+                return SharedMemoryBitmap(fd, bytes);
+            }
+            catch (...) {
+                shm_unlink(name.c_str());
+                throw;
+            }
+        }();
+
+        // The pages are zero-filled, so only the header needs initializing; Ready is published last.
+        SharedBitmapHeader* header = bitmap.Header;
+        header->Magic = SharedBitmapHeader::ExpectedMagic;
+        header->Version = SharedBitmapHeader::CurrentVersion;
+        header->HeaderSize = sizeof(SharedBitmapHeader);
+        header->WordOffset = WordOffset;
+        header->BitCount = bitCount;
+        header->Ready.store(1, std::memory_order_release);
+        return bitmap;
+    }
+
+    // Attach to an existing shared bitmap, validating its header.
+    static SharedMemoryBitmap Open(const std::string& name)
+    {
+        const int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            ThrowErrno("shm_open " + name);
+        }
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < WordOffset) {
+            close(fd);
+            throw std::runtime_error("shared bitmap " + name + " is too small for its header");
+        }
+        SharedMemoryBitmap bitmap(fd, static_cast<size_t>(info.st_size));
+
+        const SharedBitmapHeader* header = bitmap.Header;
+        if (header->Ready.load(std::memory_order_acquire) != 1 || header->Magic != SharedBitmapHeader::ExpectedMagic) {
+            throw std::runtime_error("shared bitmap " + name + " is not initialized");
+        }
+        if (header->Version != SharedBitmapHeader::CurrentVersion || header->HeaderSize != sizeof(SharedBitmapHeader)
+            || header->WordOffset != WordOffset) {
+            throw std::runtime_error("shared bitmap " + name + " has layout version " + std::to_string(header->Version)
+                + ", expected " + std::to_string(SharedBitmapHeader::CurrentVersion));
+        }
+        if (WordOffset + WordsFor(header->BitCount) * sizeof(uint64_t) > bitmap.MappedBytes) {
+            throw std::runtime_error("shared bitmap " + name + " is smaller than its bit count");
+        }
+        return bitmap;
+    }
+
+    // Remove the name; existing mappings stay valid until they are closed.
+    static void Unlink(const std::string& name)
+    {
+        shm_unlink(name.c_str());
+    }
+
+    SharedMemoryBitmap(SharedMemoryBitmap&& other) noexcept
+        : Fd(std::exchange(other.Fd, -1)), MappedBytes(std::exchange(other.MappedBytes, 0)),
+          Header(std::exchange(other.Header, nullptr)), Words(std::exchange(other.Words, nullptr)) {}
+
+    SharedMemoryBitmap& operator=(SharedMemoryBitmap&& other) noexcept {
+        if (this != &other) {
+            Release();
+            Fd = std::exchange(other.Fd, -1);
+            MappedBytes = std::exchange(other.MappedBytes, 0);
+            Header = std::exchange(other.Header, nullptr);
+            Words = std::exchange(other.Words, nullptr);
+        }
+        return *this;
+    }
+
+    SharedMemoryBitmap(const SharedMemoryBitmap&) = delete;
+    SharedMemoryBitmap& operator=(const SharedMemoryBitmap&) = delete;
+
+    ~SharedMemoryBitmap() {
+        Release();
+    }
+
+
+    // Bit Manipulation Functions:
+
+
+    // Set a specific bit at position bitPos.
+    void SetBit(const uint64_t bitPos)
+    {
+        if (!IsBitInRange(bitPos)) {
+            return;
+        }
+        Word(bitPos).fetch_or(BitOf(bitPos));
+        WakeWaiters();
+    }
+
+    // Clear a specific bit at position bitPos.
+    void ClearBit(const uint64_t bitPos)
+    {
+        if (!IsBitInRange(bitPos)) {
+            return;
+        }
+        Word(bitPos).fetch_and(~BitOf(bitPos));
+        WakeWaiters();
+    }
+
+    // Set a bit and return whether it was already set; false means this caller took it.
+    bool TestAndSet(const uint64_t bitPos)
+    {
+        if (!IsBitInRange(bitPos)) {
+            return true;
+        }
+        const uint64_t previous = Word(bitPos).fetch_or(BitOf(bitPos));
+        if ((previous & BitOf(bitPos)) != 0) {
+            return true;
+        }
+        WakeWaiters();
+        return false;
+    }
+
+    // Atomically find and set the lowest clear bit at or after from. Returns its position, or
+    // BitCount() when every bit is set.
+    uint64_t ClaimFirstClear(const uint64_t from = 0)
+    {
+        const size_t wordCount = WordsFor(BitCount());
+        for (size_t index = from / WordBits; index < wordCount; ++index) {
+            std::atomic<uint64_t>& word = Words[index];
+            const uint64_t candidates = CandidateBits(index, from);
+            uint64_t value = word.load(std::memory_order_relaxed);
+            uint64_t clear = ~value & candidates;
+            while (clear != 0) {
+                const uint64_t bit = clear & (~clear + 1);
+                if (word.compare_exchange_weak(value, value | bit)) {
+                    WakeWaiters();
+                    return index * WordBits + static_cast<uint64_t>(std::countr_zero(bit));
+                }
+                clear = ~value & candidates;
+            }
+        }
+        return BitCount();
+    }
+
+
+    // Query and Information:
+
+
+    // Run CheckPolicy on bitPos against BitCount(); false means the operation should be skipped.
+    bool IsBitInRange(const uint64_t bitPos) const {
+        return CheckPolicy::Validate(bitPos, BitCount());
+    }
+
+    // Check if a specific bit at position pos is set.
+    bool IsBitSet(const uint64_t pos) const {
+        return IsBitInRange(pos) && (Word(pos).load(std::memory_order_acquire) & BitOf(pos)) != 0;
+    }
+
+    // Position of the first clear bit at or after from, or BitCount() when there is none. The answer
+    // can be stale as soon as it is returned; use ClaimFirstClear to take ownership.
+    uint64_t FindFirstClear(const uint64_t from = 0) const {
+        const size_t wordCount = WordsFor(BitCount());
+        for (size_t index = from / WordBits; index < wordCount; ++index) {
+            const uint64_t clear = ~Words[index].load(std::memory_order_acquire) & CandidateBits(index, from);
+            if (clear != 0) {
+                return index * WordBits + static_cast<uint64_t>(std::countr_zero(clear));
+            }
+        }
+        return BitCount();
+    }
+
+    // Number of bits in the shared bitmap.
+    uint64_t BitCount() const {
+        return Header->BitCount;
+    }
+
+    // Block until the bit at pos equals value, or until timeoutNs nanoseconds pass (negative waits
+    // forever). Returns whether the bit reached the value.
+    bool WaitForBit(const uint64_t pos, const bool value, const int64_t timeoutNs = -1)
+    {
+        if (!IsBitInRange(pos)) {
+            return false;
+        }
+        Header->Waiters.fetch_add(1);
+        bool reached = false;
+        timespec deadline {};
+        if (timeoutNs >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            AddNanoseconds(deadline, timeoutNs);
+        }
+        while (true) {
+            const uint32_t sequence = Header->Sequence.load();
+            if (IsBitSet(pos) == value) {
+                reached = true;
+                break;
+            }
+            timespec remaining {};
+            if (timeoutNs >= 0 && !RemainingUntil(deadline, remaining)) {
+                break;
+            }
+            // Returns immediately if Sequence moved on since it was read.
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&Header->Sequence), FUTEX_WAIT, sequence,
+                timeoutNs >= 0 ? &remaining : nullptr, nullptr, 0);
+        }
+        Header->Waiters.fetch_sub(1);
+        return reached;
+    }
+
+private:
+    SharedMemoryBitmap(const int fd, const size_t bytes) : Fd(fd), MappedBytes(bytes)
+    {
+        void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            Fd = -1;
+            ThrowErrno("mmap");
+        }
+        Header = static_cast<SharedBitmapHeader*>(mapping);
+        Words = reinterpret_cast<std::atomic<uint64_t>*>(static_cast<char*>(mapping) + WordOffset);
+    }
+
+    static_assert(sizeof(SharedBitmapHeader) <= WordOffset, "header must fit before the shared words");
+
+    [[noreturn]] static void ThrowErrno(const std::string& what)
+    {
+        throw std::runtime_error(what + " failed: errno " + std::to_string(errno));
+    }
+
+    // Bits of word index that lie inside the bitmap and at or after from.
+    uint64_t CandidateBits(const size_t index, const uint64_t from) const
+    {
+        uint64_t bits = index + 1 == WordsFor(BitCount()) ? LastWordMask(BitCount()) : ~uint64_t(0);
+        if (index == from / WordBits) {
+            bits &= ~uint64_t(0) << (from % WordBits);
+        }
+        return bits;
+    }
+
+    static uint64_t BitOf(const uint64_t pos)
+    {
+        return uint64_t(1) << (pos % WordBits);
+    }
+
+    std::atomic<uint64_t>& Word(const uint64_t pos) const
+    {
+        return Words[pos / WordBits];
+    }
+
+    // Bump the futex word and wake sleepers, but only when someone is waiting.
+    void WakeWaiters()
+    {
+        if (Header->Waiters.load() != 0) {
+            Header->Sequence.fetch_add(1);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&Header->Sequence), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+    }
+
+    static void AddNanoseconds(timespec& time, const int64_t ns)
+    {
+        const int64_t total = time.tv_nsec + ns % 1000000000;
+        time.tv_sec += static_cast<time_t>(ns / 1000000000 + total / 1000000000);
+        time.tv_nsec = static_cast<long>(total % 1000000000);
+    }
+
+    // Time left until deadline; false once it has passed.
+    static bool RemainingUntil(const timespec& deadline, timespec& remaining)
+    {
+        timespec now {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t ns = (static_cast<int64_t>(deadline.tv_sec) - now.tv_sec) * 1000000000 + (deadline.tv_nsec - now.tv_nsec);
+        if (ns <= 0) {
+            return false;
+        }
+        remaining.tv_sec = static_cast<time_t>(ns / 1000000000);
+        remaining.tv_nsec = static_cast<long>(ns % 1000000000);
+        return true;
+    }
+
+    void Release()
+    {
+        if (Header != nullptr) {
+            munmap(Header, MappedBytes);
+            Header = nullptr;
+            Words = nullptr;
+        }
+        if (Fd >= 0) {
+            close(Fd);
+            Fd = -1;
+        }
+    }
+
+    int Fd = -1;
+    size_t MappedBytes = 0;
+    SharedBitmapHeader* Header = nullptr;
+    std::atomic<uint64_t>* Words = nullptr;
+};
+
+#endif
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "DynamicBitMask.h"
+#include "Parallel.h"
+#include "WideBitMask.h"
+#include "WordKernels.h"
+
+/*
+SignatureFile is a bit-sliced signature index for prefiltering substring and keyword searches.
+
+-Every document gets a SignatureBits wide signature: each byte n-gram of the text is hashed to
+ HashesPerGram bit positions. A document containing a pattern contains all of the pattern's n-grams,
+ so its signature has every bit of the pattern's signature; the filter has no false negatives.
+-Signatures are stored bit-sliced: Slice(b) is a DynamicBitMask over documents with bit d set when
+ document d's signature has bit b. Documents are added in blocks of 64, and each block's
+ 64 x SignatureBits signatures are turned into slice words with TransposeWords64.
+-Candidates() ANDs only the slices of the query's signature bits, rarest slice first, and stops as
+ soon as the result is empty. Documents of an incomplete trailing block are checked against their
+ signatures directly until the block fills.
+-AddDocuments() builds whole blocks in parallel; each block writes one word per slice, so workers
+ never share a word.
+-SignatureBits trades memory (SignatureBits / 8 bytes per document) for false positive rate.
+*/
+
+
+// A bit-sliced n-gram signature index over short documents.
+template <int SignatureBits = 1024>
+struct SignatureFile {
+    static_assert(SignatureBits > 0 && SignatureBits % WordBits == 0, "SignatureBits must be a multiple of 64");
+
+    using Signature = WideBitMask<SignatureBits>;
+    static constexpr size_t BlockDocuments = WordBits;
+
+
+    // Constructors and Initialization:
+
+
+    // Index n-grams of gramLength bytes, each setting hashesPerGram signature bits.
+    explicit SignatureFile(const int gramLength = 3, const int hashesPerGram = 2)
+        : GramLength(gramLength), HashesPerGram(hashesPerGram), Slices(SignatureBits), SliceCounts(SignatureBits, 0)
+    {
+        if (gramLength <= 0 || hashesPerGram <= 0) {
+            throw std::invalid_argument("SignatureFile needs a positive n-gram length and hash count");
+        }
+    }
+
+    // Signature of text: the hashed bits of all its n-grams.
+    Signature SignatureOf(const std::string_view text) const
+    {
+        Signature signature;
+        const size_t gram = static_cast<size_t>(GramLength);
+        for (size_t i = 0; i + gram <= text.size(); ++i) {
+            // FNV-1a, with double hashing for the extra bit positions.
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t j = 0; j < gram; ++j) {
+                hash = (hash ^ static_cast<uint8_t>(text[i + j])) * 1099511628211ull;
+            }
+            const uint64_t step = (hash >> 32) | 1;
+            for (int k = 0; k < HashesPerGram; ++k) {
+                signature.SetBit(static_cast<int>((hash + k * step) % SignatureBits));
+            }
+        }
+        return signature;
+    }
+
+
+    // Adding Documents:
+
+
+    // Append one document; its id is the previous DocumentCount().
+    void AddDocument(const std::string_view text)
+    {
+        Pending.push_back(SignatureOf(text));
+        if (Pending.size() == BlockDocuments) {
+            GrowSlices(CommittedDocuments + BlockDocuments);
+            StoreBlock(CommittedDocuments / BlockDocuments, Pending.data(), BlockDocuments);
+            CommitBlock(CommittedDocuments / BlockDocuments);
+            CommittedDocuments += BlockDocuments;
+            Pending.clear();
+        }
+    }
+
+    // Append many documents, building their full blocks in parallel.
+    void AddDocuments(const std::vector<std::string_view>& texts)
+    {
+        size_t next = 0;
+        while (next < texts.size() && !Pending.empty()) {
+            AddDocument(texts[next++]);
+        }
+        const size_t blocks = (texts.size() - next) / BlockDocuments;
+        if (blocks != 0) {
+            const size_t firstBlock = CommittedDocuments / BlockDocuments;
+            GrowSlices(CommittedDocuments + blocks * BlockDocuments);
+            ParallelChunks(blocks, WorkerCount(), [&](unsigned, size_t begin, size_t end) {
+                std::vector<Signature> signatures(BlockDocuments);
+                for (size_t block = begin; block < end; ++block) {
+                    for (size_t i = 0; i < BlockDocuments; ++i) {
+                        signatures[i] = SignatureOf(texts[next + block * BlockDocuments + i]);
+                    }
+                    StoreBlock(firstBlock + block, signatures.data(), BlockDocuments);
+                }
+            });
+            for (size_t block = 0; block < blocks; ++block) {
+                CommitBlock(firstBlock + block);
+            }
+            CommittedDocuments += blocks * BlockDocuments;
+            next += blocks * BlockDocuments;
+        }
+        while (next < texts.size()) {
+            AddDocument(texts[next++]);
+        }
+    }
+
+
+    // Query and Information:
+
+
+    // Number of indexed documents.
+    int DocumentCount() const {
+        return static_cast<int>(CommittedDocuments + Pending.size());
+    }
+
+    // Documents whose signature has bit `bit`, over the complete blocks only.
+    const DynamicBitMask<>& Slice(const int bit) const {
+        return Slices[bit];
+    }
+
+    // Documents that may contain pattern. Patterns shorter than the n-gram length match everything.
+    DynamicBitMask<> Candidates(const std::string_view pattern) const
+    {
+        const Signature query = SignatureOf(pattern);
+        std::vector<int> bits;
+        query.ForEachSetBit([&](int bit) { bits.push_back(bit); });
+        std::sort(bits.begin(), bits.end(), [&](int a, int b) { return SliceCounts[a] < SliceCounts[b]; });
+
+        DynamicBitMask<> result(static_cast<int>(CommittedDocuments));
+        if (bits.empty()) {
+            result.SetAllBits();
+        }
+        else {
+            result = Slices[bits.front()];
+            for (size_t i = 1; i < bits.size() && result.AnyBitSet(); ++i) {
+                result &= Slices[bits[i]];
+            }
+        }
+        result.Resize(DocumentCount());
+        for (size_t i = 0; i < Pending.size(); ++i) {
+            if ((Pending[i] & query) == query) {
+                result.SetBit(static_cast<int>(CommittedDocuments + i));
+            }
+        }
+        return result;
+    }
+
+    // Call func(document) for every candidate of pattern in increasing order.
+    template <typename Func>
+    void ForEachCandidate(const std::string_view pattern, Func&& func) const {
+        Candidates(pattern).ForEachSetBit(func);
+    }
+
+    // Bytes held by the slices and the pending block.
+    size_t MemoryBytes() const {
+        size_t bytes = Pending.size() * sizeof(Signature);
+        for (const DynamicBitMask<>& slice : Slices) {
+            bytes += slice.WordCount() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+private:
+    void GrowSlices(const size_t documents) {
+        for (DynamicBitMask<>& slice : Slices) {
+            slice.Resize(static_cast<int>(documents));
+        }
+    }
+
+    // Transpose count signatures into word `block` of every slice, 64 signature bits at a time.
+    void StoreBlock(const size_t block, const Signature* signatures, const size_t count)
+    {
+        uint64_t matrix[WordBits];
+        for (size_t word = 0; word < Signature::WordCount; ++word) {
+            for (size_t i = 0; i < WordBits; ++i) {
+                matrix[i] = i < count ? signatures[i].Words[word] : 0;
+            }
+            TransposeWords64(matrix);
+            for (size_t bit = 0; bit < WordBits; ++bit) {
+                Slices[word * WordBits + bit].Words[block] = matrix[bit];
+            }
+        }
+    }
+
+    // Add a stored block to the per-slice document counts used to order query slices.
+    void CommitBlock(const size_t block) {
+        for (size_t bit = 0; bit < static_cast<size_t>(SignatureBits); ++bit) {
+            SliceCounts[bit] += static_cast<size_t>(std::popcount(Slices[bit].Words[block]));
+        }
+    }
+
+    int GramLength;
+    int HashesPerGram;
+    std::vector<DynamicBitMask<>> Slices;
+    std::vector<size_t> SliceCounts;
+    std::vector<Signature> Pending;
+    size_t CommittedDocuments = 0;
+};
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Arena.h"
+#include "Bitmask.h"
+
+/*
+SparseArray is a fixed size array of mostly absent values that stores only the present ones.
+
+-Indices are grouped into blocks of Block (at most 64). Each block keeps a BitMask<uint64_t> of its
+ present indices and a packed array of their values in index order, so index i of a block lives at
+ Present.CountSetBitsBelow(i).
+-Lookup is IsBitSet plus one masked popcount; iteration scans the set bits of each block.
+-Insert and Erase shift at most Block values. Value arrays grow by doubling and shrink by half once
+ they are a quarter full, so reallocation is amortized.
+-With a BumpArena the value arrays come from the arena; arrays released by growth or shrinking go
+ onto per-capacity free lists and are reused by later allocations of the same capacity.
+-Memory is n * sizeof(T) for n present values plus one mask, pointer and capacity per block (24
+ bytes with padding): roughly 3N / 8 bytes for N indices when Block is 64.
+*/
+
+
+// An array of size indices that stores values only for the present ones.
+template <typename T, int Block = 64>
+struct SparseArray {
+    static_assert(Block > 0 && Block <= 64, "SparseArray blocks hold 1 to 64 indices");
+    static_assert(alignof(T) <= alignof(std::max_align_t), "SparseArray values need at most max_align_t alignment");
+
+    using PresenceMask = BitMask<uint64_t, uint64_t, Block>;
+    static constexpr int MaxCapacity = static_cast<int>(std::bit_ceil(static_cast<unsigned>(Block)));
+
+
+    // Constructors and Initialization:
+
+
+    // size absent indices; value arrays come from the heap, or from arena when given.
+    explicit SparseArray(const size_t size, BumpArena* arena = nullptr)
+        : Blocks((size + Block - 1) / Block), Length(size), Arena(arena) {}
+
+    SparseArray(const SparseArray&) = delete;
+    SparseArray& operator=(const SparseArray&) = delete;
+
+    SparseArray(SparseArray&& other) noexcept
+        : Blocks(std::move(other.Blocks)), Length(std::exchange(other.Length, 0)), Present(std::exchange(other.Present, 0)), Arena(other.Arena)
+    {
+        std::copy(std::begin(other.FreeLists), std::end(other.FreeLists), std::begin(FreeLists));
+        std::fill(std::begin(other.FreeLists), std::end(other.FreeLists), nullptr);
+    }
+
+    ~SparseArray() {
+        ResetAll();
+    }
+
+    // Remove every value.
+    void ResetAll() {
+        for (BlockData& block : Blocks) {
+            std::destroy_n(block.Values, block.Present.CountSetBits());
+            Deallocate(block.Values, block.Capacity);
+            block = BlockData();
+        }
+        Present = 0;
+    }
+
+
+    // Modifiers:
+
+
+    // Store value at index; returns true if the index was absent. value is taken by copy, so it may
+    // refer to an element of this array.
+    bool Insert(const size_t index, T value)
+    {
+        CheckIndex(index);
+        BlockData& block = Blocks[index / Block];
+        const uint64_t offset = index % Block;
+        const int rank = block.Present.CountSetBitsBelow(offset);
+        if (block.Present.IsBitSet(offset)) {
+            block.Values[rank] = std::move(value);
+            return false;
+        }
+        const int count = block.Present.CountSetBits();
+        if (count == block.Capacity) {
+            const int capacity = block.Capacity == 0 ? 1 : std::min(block.Capacity * 2, MaxCapacity);
+            T* values = Allocate(capacity);
+            // The block keeps its old array, untouched, until every value has been relocated.
+            int constructed = 0;
+            try {
+                Relocate(block.Values, rank, values);
+                constructed = rank;
+                new (values + rank) T(std::move(value));
+                ++constructed;
+                Relocate(block.Values + rank, count - rank, values + rank + 1);
+            }
+            catch (...) {
+                std::destroy_n(values, constructed);
+                Deallocate(values, capacity);
+                throw;
+            }
+            std::destroy_n(block.Values, count);
+            Deallocate(block.Values, block.Capacity);
+            block.Values = values;
+            block.Capacity = static_cast<uint8_t>(capacity);
+        }
+        else if (rank == count) {
+            new (block.Values + count) T(std::move(value));
+        }
+        else {
+            new (block.Values + count) T(std::move(block.Values[count - 1]));
+            std::move_backward(block.Values + rank, block.Values + count - 1, block.Values + count);
+            block.Values[rank] = std::move(value);
+        }
+        block.Present.SetBit(offset);
+        ++Present;
+        return true;
+    }
+
+    // Remove the value at index; returns false if it was absent.
+    bool Erase(const size_t index)
+    {
+        CheckIndex(index);
+        BlockData& block = Blocks[index / Block];
+        const uint64_t offset = index % Block;
+        if (!block.Present.IsBitSet(offset)) {
+            return false;
+        }
+        const int rank = block.Present.CountSetBitsBelow(offset);
+        const int count = block.Present.CountSetBits();
+        std::move(block.Values + rank + 1, block.Values + count, block.Values + rank);
+        std::destroy_at(block.Values + count - 1);
+        block.Present.ClearBit(offset);
+        --Present;
+
+        const int remaining = count - 1;
+        if (remaining == 0) {
+            Deallocate(block.Values, block.Capacity);
+            block.Values = nullptr;
+            block.Capacity = 0;
+        }
+        else if (block.Capacity > 1 && remaining * 4 <= block.Capacity) {
+            const int capacity = block.Capacity / 2;
+            T* values = Allocate(capacity);
+            // Shrinking is optional: if relocating throws, the erase stands and the block keeps its array.
+            try {
+                Relocate(block.Values, remaining, values);
+            }
+            catch (...) {
+                Deallocate(values, capacity);
+                return true;
+            }
+            std::destroy_n(block.Values, remaining);
+            Deallocate(block.Values, block.Capacity);
+            block.Values = values;
+            block.Capacity = static_cast<uint8_t>(capacity);
+        }
+        return true;
+    }
+
+
+    // Query and Information:
+
+
+    // Number of indices.
+    size_t Size() const {
+        return Length;
+    }
+
+    // Number of present values.
+    size_t Count() const {
+        return Present;
+    }
+
+    bool Contains(const size_t index) const {
+        return index < Length && Blocks[index / Block].Present.IsBitSet(index % Block);
+    }
+
+    // Pointer to the value at index, or nullptr when it is absent.
+    const T* Find(const size_t index) const {
+        if (!Contains(index)) {
+            return nullptr;
+        }
+        const BlockData& block = Blocks[index / Block];
+        return block.Values + block.Present.CountSetBitsBelow(index % Block);
+    }
+
+    T* Find(const size_t index) {
+        return const_cast<T*>(std::as_const(*this).Find(index));
+    }
+
+    // Value at index, or fallback when it is absent.
+    T Get(const size_t index, const T& fallback = T()) const {
+        const T* value = Find(index);
+        return value != nullptr ? *value : fallback;
+    }
+
+    // Call func(index, value) for every present value in increasing index order.
+    template <typename Func>
+    void ForEach(Func&& func) const {
+        for (size_t b = 0; b < Blocks.size(); ++b) {
+            const BlockData& block = Blocks[b];
+            int rank = 0;
+            for (uint64_t bits = block.Present.Mask; bits != 0; bits &= bits - 1) {
+                func(b * Block + static_cast<size_t>(std::countr_zero(bits)), block.Values[rank++]);
+            }
+        }
+    }
+
+    // Bytes used by the block table and the value arrays.
+    size_t MemoryBytes() const {
+        size_t bytes = Blocks.size() * sizeof(BlockData);
+        for (const BlockData& block : Blocks) {
+            bytes += static_cast<size_t>(block.Capacity) * sizeof(T);
+        }
+        return bytes;
+    }
+
+private:
+    struct BlockData {
+        PresenceMask Present;
+        T* Values = nullptr;
+        uint8_t Capacity = 0;
+    };
+
+    // Capacities are powers of two, so each has its own free list.
+    static constexpr int CapacityClasses = std::bit_width(static_cast<unsigned>(MaxCapacity));
+
+    void*& FreeList(const int capacity) {
+        return FreeLists[std::min(std::countr_zero(static_cast<unsigned>(capacity)), CapacityClasses - 1)];
+    }
+
+    // Arena slots also hold the free list link while they are unused.
+    static size_t SlotBytes(const int capacity) {
+        return std::max(static_cast<size_t>(capacity) * sizeof(T), sizeof(void*));
+    }
+
+    T* Allocate(const int capacity) {
+        if (Arena == nullptr) {
+            return static_cast<T*>(::operator new(static_cast<size_t>(capacity) * sizeof(T)));
+        }
+        void*& head = FreeList(capacity);
+        if (head != nullptr) {
+            void* slot = head;
+            head = *static_cast<void**>(slot);
+            return static_cast<T*>(slot);
+        }
+        return static_cast<T*>(Arena->Allocate(SlotBytes(capacity)));
+    }
+
+    void Deallocate(T* values, const int capacity) {
+        if (values == nullptr) {
+            return;
+        }
+        if (Arena == nullptr) {
+            ::operator delete(static_cast<void*>(values));
+            return;
+        }
+        void*& head = FreeList(capacity);
+        *reinterpret_cast<void**>(values) = head;
+        head = values;
+    }
+
+    // Construct dst[0 .. count) from src. Like std::vector, values are moved only when that cannot
+    // throw (or T cannot be copied), so src is intact if a copy throws.
+    static void Relocate(T* src, const int count, T* dst) {
+        if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+            std::uninitialized_move_n(src, count, dst);
+        }
+        else {
+            std::uninitialized_copy_n(src, count, dst);
+        }
+    }
+
+    void CheckIndex(const size_t index) const {
+        if (index >= Length) {
+            throw std::out_of_range("SparseArray index " + std::to_string(index) + " is outside the array");
+        }
+    }
+
+    std::vector<BlockData> Blocks;
+    size_t Length;
+    size_t Present = 0;
+    BumpArena* Arena;
+    void* FreeLists[CapacityClasses] = {};
+};
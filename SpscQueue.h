@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+/*
+Bounded lock-free single-producer / single-consumer ring buffer.
+
+One thread calls TryPush, one other thread calls TryPop. Head and tail live on separate cache lines
+and each side caches the other side's index, so the shared counters are only reloaded when the
+queue looks full (producer) or empty (consumer).
+*/
+
+
+// Cache line size used to keep the producer and consumer indices apart.
+constexpr size_t QueueCacheLine = 64;
+
+// A bounded single-producer single-consumer queue; the capacity is rounded up to a power of two.
+template <typename T>
+struct SpscQueue {
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        Mask = rounded - 1;
+        Slots = std::make_unique<T[]>(rounded);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side: copy value into the queue, or return false if it is full.
+    bool TryPush(const T& value)
+    {
+        const size_t tail = Tail.load(std::memory_order_relaxed);
+        if (tail - CachedHead > Mask) {
+            CachedHead = Head.load(std::memory_order_acquire);
+            if (tail - CachedHead > Mask) {
+                return false;
+            }
+        }
+        Slots[tail & Mask] = value;
+        Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: move the oldest value into out, or return false if the queue is empty.
+    bool TryPop(T& out)
+    {
+        const size_t head = Head.load(std::memory_order_relaxed);
+        if (head == CachedTail) {
+            CachedTail = Tail.load(std::memory_order_acquire);
+            if (head == CachedTail) {
+                return false;
+            }
+        }
+        out = std::move(Slots[head & Mask]);
+        Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Check if the queue is empty; only exact when both sides are idle.
+    bool IsEmpty() const
+    {
+        return Head.load(std::memory_order_acquire) == Tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::unique_ptr<T[]> Slots;
+    size_t Mask = 0;
+
+    alignas(QueueCacheLine) std::atomic<size_t> Head{ 0 };
+    size_t CachedTail = 0;
+
+    alignas(QueueCacheLine) std::atomic<size_t> Tail{ 0 };
+    size_t CachedHead = 0;
+};
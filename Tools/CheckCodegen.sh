@@ -0,0 +1,33 @@
+#!/bin/sh
+# Check that BitCheck::Unchecked masks compile to the same instructions as raw shifts.
+# Usage: Tools/CheckCodegen.sh [compiler]   (default: g++; needs objdump)
+set -eu
+
+CXX=${1:-g++}
+DIR=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Disassemble the Probe* functions, without addresses or encodings.
+disassemble() {
+    objdump -d --no-show-raw-insn "$1" | awk '
+        /^[0-9a-f]+ <Probe[A-Za-z0-9]*>:$/ { print $2; keep = 1; next }
+        /^$/ { keep = 0 }
+        keep { sub(/^ *[0-9a-f]+:\t/, ""); print }'
+}
+
+"$CXX" -std=c++20 -O2 -c "$DIR/CodegenProbe.cpp" -DCODEGEN_BASELINE -o "$WORK/baseline.o"
+"$CXX" -std=c++20 -O2 -c "$DIR/CodegenProbe.cpp" -o "$WORK/mask.o"
+disassemble "$WORK/baseline.o" > "$WORK/baseline.s"
+disassemble "$WORK/mask.o" > "$WORK/mask.s"
+
+if ! grep -q '<ProbeSetBit>' "$WORK/baseline.s"; then
+    echo "CheckCodegen: no probe functions found in the disassembly" >&2
+    exit 2
+fi
+if diff -u "$WORK/baseline.s" "$WORK/mask.s"; then
+    echo "CheckCodegen: Unchecked masks match raw shifts"
+else
+    echo "CheckCodegen: Unchecked masks differ from raw shifts" >&2
+    exit 1
+fi
@@ -0,0 +1,29 @@
+// Probe for CheckCodegen.sh: the same operations written with BitMask<..., BitCheck::Unchecked> and,
+// with CODEGEN_BASELINE defined, as raw shifts. Both builds must compile to identical instructions.
+
+#include <cstdint>
+
+#include "../Bitmask.h"
+
+#ifdef CODEGEN_BASELINE
+
+extern "C" uint64_t ProbeSetBit(uint64_t mask, uint64_t pos) { return mask | (uint64_t(1) << pos); }
+extern "C" uint64_t ProbeClearBit(uint64_t mask, uint64_t pos) { return mask & ~(uint64_t(1) << pos); }
+extern "C" uint64_t ProbeToggleBit(uint64_t mask, uint64_t pos) { return mask ^ (uint64_t(1) << pos); }
+extern "C" bool ProbeIsBitSet(uint64_t mask, uint64_t pos) { return (mask & (uint64_t(1) << pos)) != 0; }
+extern "C" uint32_t ProbeSetBit32(uint32_t mask, int pos) { return mask | (uint32_t(1) << pos); }
+extern "C" bool ProbeIsBitSet32(uint32_t mask, int pos) { return (mask & (uint32_t(1) << pos)) != 0; }
+
+#else
+
+using Mask64 = BitMask<uint64_t, uint64_t, 64, BitCheck::Unchecked>;
+using Mask32 = BitMask<uint32_t, int, 32, BitCheck::Unchecked>;
+
+extern "C" uint64_t ProbeSetBit(uint64_t mask, uint64_t pos) { Mask64 m(mask); m.SetBit(pos); return m.Mask; }
+extern "C" uint64_t ProbeClearBit(uint64_t mask, uint64_t pos) { Mask64 m(mask); m.ClearBit(pos); return m.Mask; }
+extern "C" uint64_t ProbeToggleBit(uint64_t mask, uint64_t pos) { Mask64 m(mask); m.ToggleBit(pos); return m.Mask; }
+extern "C" bool ProbeIsBitSet(uint64_t mask, uint64_t pos) { return Mask64(mask).IsBitSet(pos); }
+extern "C" uint32_t ProbeSetBit32(uint32_t mask, int pos) { Mask32 m(mask); m.SetBit(pos); return m.Mask; }
+extern "C" bool ProbeIsBitSet32(uint32_t mask, int pos) { return Mask32(mask).IsBitSet(pos); }
+
+#endif
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Parallel.h"
+#include "PrefixPopcount.h"
+#include "WordKernels.h"
+
+/*
+Top-k selection of masks by how many query bits they match or by a weighted sum of their bits.
+
+-Masks are read as runs of 64-bit words, so WideBitMask, DynamicBitMask and every BitMask /
+ raw unsigned word type are accepted.
+-TopKByPopcount scores each mask with AndPopCountWords against the query. Scores are bounded by
+ the query's popcount, so instead of a sort a histogram of the scores gives the cut-off score, and
+ one pass collects the masks above it plus the first ones at it (a partial counting sort).
+-TopKByWeight precomputes, for every byte of the mask, a 256 entry table of summed bit weights, so
+ each 64-bit word costs 8 table lookups instead of 64 bit tests. A bounded min-heap keeps the best k.
+-Scoring is split across threads; selection is serial. Results are ordered best first, with ties
+ broken by the lower mask index.
+*/
+
+
+// A selected mask: its index in the input and its score.
+template <typename ScoreType>
+struct RankedMask {
+    size_t Index;
+    ScoreType Score;
+};
+
+// Word run of a mask: multi-word masks expose their words, single word masks are widened to 64 bits.
+template <typename Mask>
+std::pair<const uint64_t*, size_t> MaskWordSpan(const Mask& mask, uint64_t& scratch)
+{
+    if constexpr (requires { mask.Words.data(); mask.Words.size(); }) {
+        return { mask.Words.data(), mask.Words.size() };
+    }
+    else {
+        scratch = MaskWordValue(mask);
+        return { &scratch, 1 };
+    }
+}
+
+// Minimum number of masks a worker scores before scoring goes parallel.
+constexpr size_t TopKScoreBlock = size_t(1) << 12;
+
+// Per-byte tables of summed bit weights.
+struct ByteWeightTable {
+    // weights[b] is the score of bit b; bits past the end of weights score zero.
+    explicit ByteWeightTable(const std::vector<double>& weights)
+        : ByteCount((weights.size() + 7) / 8), Tables(ByteCount * 256, 0.0)
+    {
+        for (size_t byte = 0; byte < ByteCount; ++byte) {
+            double* table = Tables.data() + byte * 256;
+            for (unsigned value = 1; value < 256; ++value) {
+                const size_t bit = byte * 8 + static_cast<size_t>(std::countr_zero(value));
+                table[value] = table[value & (value - 1)] + (bit < weights.size() ? weights[bit] : 0.0);
+            }
+        }
+    }
+
+    // Weighted sum of the set bits of count words.
+    double Score(const uint64_t* words, const size_t count) const
+    {
+        double score = 0;
+        const size_t wordLimit = std::min(count, (ByteCount + 7) / 8);
+        for (size_t i = 0; i < wordLimit; ++i) {
+            const uint64_t word = words[i];
+            const size_t bytes = std::min<size_t>(8, ByteCount - i * 8);
+            const double* table = Tables.data() + i * 8 * 256;
+            for (size_t byte = 0; byte < bytes; ++byte) {
+                score += table[byte * 256 + ((word >> (8 * byte)) & 0xFF)];
+            }
+        }
+        return score;
+    }
+
+    size_t ByteCount;
+    std::vector<double> Tables;
+};
+
+// The k masks sharing the most set bits with query, best first.
+template <typename Mask>
+std::vector<RankedMask<int>> TopKByPopcount(const std::vector<Mask>& masks, const Mask& query, size_t k)
+{
+    k = std::min(k, masks.size());
+    if (k == 0) {
+        return {};
+    }
+    uint64_t queryScratch = 0;
+    const auto [queryWords, queryCount] = MaskWordSpan(query, queryScratch);
+
+    std::vector<int> scores(masks.size());
+    ParallelChunks(masks.size(), ChunksFor(masks.size(), TopKScoreBlock), [&](unsigned, size_t begin, size_t end) {
+        uint64_t scratch = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const auto [words, count] = MaskWordSpan(masks[i], scratch);
+            scores[i] = static_cast<int>(AndPopCountWords(words, queryWords, std::min(count, queryCount)));
+        }
+    });
+
+    // Histogram of scores, then walk down from the best score until k masks are covered.
+    const size_t maxScore = PopCountWords(queryWords, queryCount);
+    std::vector<size_t> histogram(maxScore + 1, 0);
+    for (const int score : scores) {
+        ++histogram[static_cast<size_t>(score)];
+    }
+    size_t cutoff = maxScore;
+    size_t above = 0;
+    while (above + histogram[cutoff] < k) {
+        above += histogram[cutoff--];
+    }
+    size_t atCutoff = k - above;
+
+    std::vector<RankedMask<int>> result;
+    result.reserve(k);
+    for (size_t i = 0; i < scores.size(); ++i) {
+        const size_t score = static_cast<size_t>(scores[i]);
+        if (score > cutoff) {
+            result.push_back({ i, scores[i] });
+        }
+        else if (score == cutoff && atCutoff != 0) {
+            result.push_back({ i, scores[i] });
+            --atCutoff;
+        }
+    }
+    std::stable_sort(result.begin(), result.end(), [](const RankedMask<int>& a, const RankedMask<int>& b) { return a.Score > b.Score; });
+    return result;
+}
+
+// The k masks with the highest sum of weights[b] over their set bits b, best first.
+template <typename Mask>
+std::vector<RankedMask<double>> TopKByWeight(const std::vector<Mask>& masks, const std::vector<double>& weights, size_t k)
+{
+    k = std::min(k, masks.size());
+    if (k == 0) {
+        return {};
+    }
+    const ByteWeightTable table(weights);
+    std::vector<double> scores(masks.size());
+    ParallelChunks(masks.size(), ChunksFor(masks.size(), TopKScoreBlock), [&](unsigned, size_t begin, size_t end) {
+        uint64_t scratch = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const auto [words, count] = MaskWordSpan(masks[i], scratch);
+            scores[i] = table.Score(words, count);
+        }
+    });
+
+    // Min-heap of the best k so far; its front is the entry the next candidate has to beat.
+    const auto better = [](const RankedMask<double>& a, const RankedMask<double>& b) {
+        return a.Score > b.Score || (a.Score == b.Score && a.Index < b.Index);
+    };
+    std::vector<RankedMask<double>> heap;
+    heap.reserve(k);
+    for (size_t i = 0; i < scores.size(); ++i) {
+        const RankedMask<double> candidate{ i, scores[i] };
+        if (heap.size() < k) {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+        else if (better(candidate, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+    std::sort(heap.begin(), heap.end(), better);
+    return heap;
+}
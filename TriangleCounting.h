@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "DynamicBitMask.h"
+#include "Parallel.h"
+#include "WordKernels.h"
+
+/*
+TriangleGraph counts triangles and common neighbors on large sparse graphs with hybrid adjacency:
+hub vertices keep their neighborhood as a DynamicBitMask row, all others as a sorted array.
+
+-Vertices are relabeled by rank, ordered by degree and then id, so the hubs are the highest ranks.
+ Adjacency is a CSR of ranks sorted in increasing order, and every edge is oriented from its
+ lower rank end to its higher rank end. A vertex's out-neighbors are the tail of its sorted row, and
+ the degree ordering keeps every out-degree below sqrt(2m).
+-A vertex is a hub when its degree is at least hubDegree. The default is n / 32 (at least 64), the
+ degree where an n bit row is no larger than a sorted array of 32-bit ranks, so hub rows cost at
+ most as much as the arrays they shadow.
+-Every triangle is counted once, at its oriented edge u -> v with the lowest two ranks, as the common
+ neighbors of u and v ranked above v. Each edge picks its intersection by representation: a fused
+ AND-popcount over the two rows from v's word onward when both ends are hubs, and a bit probe per
+ array element against the hub's row when only v is. Between two array vertices, u's out-neighbors
+ are first scattered into a per-worker scratch mask, and each v's out-neighbors are probed against
+ it, so no edge pays for a merge over u's row.
+-CountTriangles is parallel over edges: workers pull fixed blocks of oriented edges from a shared
+ counter, so hub-heavy blocks do not stall a static split.
+*/
+
+
+// Undirected graph with hybrid mask / sorted array adjacency for triangle and common neighbor counts.
+struct TriangleGraph {
+    // Oriented edges a worker takes from the shared counter at a time.
+    static constexpr size_t EdgesPerBlock = size_t(1) << 14;
+
+
+    // Constructors and Initialization:
+
+
+    // Graph of vertexCount vertices with the given undirected edges; self loops and duplicates are
+    // ignored. Vertices of degree hubDegree or more get mask rows; 0 picks max(n / 32, 64).
+    TriangleGraph(const int vertexCount, const std::vector<std::pair<int, int>>& edges, const int hubDegree = 0)
+        : Vertices(vertexCount)
+    {
+        if (vertexCount < 0) {
+            throw std::invalid_argument("TriangleGraph needs a non-negative vertex count");
+        }
+        const size_t n = static_cast<size_t>(vertexCount);
+
+        // Input rows by counting sort, then sorted and deduplicated in place.
+        std::vector<size_t> start(n + 1, 0);
+        for (const auto& [a, b] : edges) {
+            if (a < 0 || b < 0 || a >= vertexCount || b >= vertexCount) {
+                throw std::out_of_range("TriangleGraph edge has a vertex outside the graph");
+            }
+            if (a != b) {
+                ++start[static_cast<size_t>(a) + 1];
+                ++start[static_cast<size_t>(b) + 1];
+            }
+        }
+        for (size_t v = 0; v < n; ++v) {
+            start[v + 1] += start[v];
+        }
+        std::vector<int> rows(start[n]);
+        std::vector<size_t> fill(start.begin(), start.end() - 1);
+        for (const auto& [a, b] : edges) {
+            if (a != b) {
+                rows[fill[static_cast<size_t>(a)]++] = b;
+                rows[fill[static_cast<size_t>(b)]++] = a;
+            }
+        }
+        std::vector<int> degree(n);
+        ParallelChunks(n, ChunksFor(n, 4096), [&](unsigned, size_t begin, size_t end) {
+            for (size_t v = begin; v < end; ++v) {
+                const auto first = rows.begin() + static_cast<std::ptrdiff_t>(start[v]);
+                const auto last = rows.begin() + static_cast<std::ptrdiff_t>(start[v + 1]);
+                std::sort(first, last);
+                degree[v] = static_cast<int>(std::unique(first, last) - first);
+            }
+        });
+
+        // Rank by degree, then id.
+        Order.resize(n);
+        for (size_t v = 0; v < n; ++v) {
+            Order[v] = static_cast<int>(v);
+        }
+        std::stable_sort(Order.begin(), Order.end(), [&](int a, int b) {
+            return degree[static_cast<size_t>(a)] < degree[static_cast<size_t>(b)];
+        });
+        Rank.resize(n);
+        for (size_t r = 0; r < n; ++r) {
+            Rank[static_cast<size_t>(Order[r])] = static_cast<int>(r);
+        }
+
+        // Rows relabeled to ranks, plus the start of each row's out-neighbors and the running count
+        // of oriented edges.
+        Offsets.assign(n + 1, 0);
+        for (size_t r = 0; r < n; ++r) {
+            Offsets[r + 1] = Offsets[r] + static_cast<size_t>(degree[static_cast<size_t>(Order[r])]);
+        }
+        Neighbors.resize(Offsets[n]);
+        OutBegin.resize(n);
+        ParallelChunks(n, ChunksFor(n, 4096), [&](unsigned, size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r) {
+                const size_t v = static_cast<size_t>(Order[r]);
+                int* row = Neighbors.data() + Offsets[r];
+                for (size_t i = 0; i < static_cast<size_t>(degree[v]); ++i) {
+                    row[i] = Rank[static_cast<size_t>(rows[start[v] + i])];
+                }
+                std::sort(row, row + degree[v]);
+                OutBegin[r] = static_cast<size_t>(std::upper_bound(row, row + degree[v], static_cast<int>(r)) - Neighbors.data());
+            }
+        });
+        OutPrefix.assign(n + 1, 0);
+        for (size_t r = 0; r < n; ++r) {
+            OutPrefix[r + 1] = OutPrefix[r] + (Offsets[r + 1] - OutBegin[r]);
+        }
+
+        // Hubs are a suffix of the ranks.
+        const int hubMin = hubDegree > 0 ? hubDegree : std::max(vertexCount / 32, 64);
+        FirstHub = static_cast<int>(std::lower_bound(Order.begin(), Order.end(), hubMin, [&](int v, int minimum) {
+            return degree[static_cast<size_t>(v)] < minimum;
+        }) - Order.begin());
+        HubRows.assign(n - static_cast<size_t>(FirstHub), DynamicBitMask<>(vertexCount));
+        ParallelChunks(HubRows.size(), ChunksFor(HubRows.size(), 16), [&](unsigned, size_t begin, size_t end) {
+            for (size_t h = begin; h < end; ++h) {
+                const size_t r = static_cast<size_t>(FirstHub) + h;
+                for (size_t i = Offsets[r]; i < Offsets[r + 1]; ++i) {
+                    HubRows[h].SetBit(Neighbors[i]);
+                }
+            }
+        });
+    }
+
+
+    // Query and Information:
+
+
+    int VertexCount() const {
+        return Vertices;
+    }
+
+    // Number of distinct undirected edges.
+    size_t EdgeCount() const {
+        return OutPrefix.back();
+    }
+
+    int Degree(const int v) const {
+        const size_t r = static_cast<size_t>(Rank[static_cast<size_t>(v)]);
+        return static_cast<int>(Offsets[r + 1] - Offsets[r]);
+    }
+
+    // Number of vertices with mask rows.
+    int HubCount() const {
+        return Vertices - FirstHub;
+    }
+
+    bool IsHub(const int v) const {
+        return Rank[static_cast<size_t>(v)] >= FirstHub;
+    }
+
+    // Number of vertices adjacent to both a and b.
+    size_t CommonNeighbors(const int a, const int b) const
+    {
+        int ra = Rank[static_cast<size_t>(a)];
+        int rb = Rank[static_cast<size_t>(b)];
+        if (ra > rb) {
+            std::swap(ra, rb);
+        }
+        const size_t ua = static_cast<size_t>(ra);
+        if (ra >= FirstHub) {
+            const std::vector<uint64_t>& rowA = HubRow(ra).Words;
+            return AndPopCountWords(rowA.data(), HubRow(rb).Words.data(), rowA.size());
+        }
+        if (rb >= FirstHub) {
+            return ProbeCount(Neighbors.data() + Offsets[ua], Neighbors.data() + Offsets[ua + 1], HubRow(rb));
+        }
+        const size_t ub = static_cast<size_t>(rb);
+        return MergeCount(Neighbors.data() + Offsets[ua], Neighbors.data() + Offsets[ua + 1],
+            Neighbors.data() + Offsets[ub], Neighbors.data() + Offsets[ub + 1]);
+    }
+
+    // Number of triangles, counted in parallel over oriented edges.
+    uint64_t CountTriangles() const
+    {
+        const size_t edgeCount = EdgeCount();
+        const size_t blocks = (edgeCount + EdgesPerBlock - 1) / EdgesPerBlock;
+        std::atomic<size_t> nextBlock{ 0 };
+        std::atomic<uint64_t> total{ 0 };
+        const size_t workers = std::min<size_t>(blocks, WorkerCount());
+        ParallelChunks(workers, static_cast<unsigned>(workers), [&](unsigned, size_t, size_t) {
+            uint64_t local = 0;
+            DynamicBitMask<> marks(Vertices);
+            for (size_t block = nextBlock++; block < blocks; block = nextBlock++) {
+                const size_t first = block * EdgesPerBlock;
+                local += CountEdgeRange(first, std::min(first + EdgesPerBlock, edgeCount), marks);
+            }
+            total += local;
+        });
+        return total.load();
+    }
+
+    // Bytes held by the rows, the rank maps and the hub masks.
+    size_t MemoryBytes() const
+    {
+        size_t bytes = (Offsets.size() + OutBegin.size() + OutPrefix.size()) * sizeof(size_t)
+            + (Neighbors.size() + Order.size() + Rank.size()) * sizeof(int);
+        for (const DynamicBitMask<>& row : HubRows) {
+            bytes += row.Words.size() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+private:
+    const DynamicBitMask<>& HubRow(const int rank) const {
+        return HubRows[static_cast<size_t>(rank - FirstHub)];
+    }
+
+    // Triangles closed by oriented edges [first, last), in OutPrefix numbering. marks is an all clear
+    // scratch mask over ranks, and is left clear.
+    uint64_t CountEdgeRange(const size_t first, const size_t last, DynamicBitMask<>& marks) const
+    {
+        uint64_t count = 0;
+        size_t u = static_cast<size_t>(std::upper_bound(OutPrefix.begin(), OutPrefix.end(), first) - OutPrefix.begin()) - 1;
+        for (size_t e = first; e < last; ++u) {
+            const size_t rowEnd = Offsets[u + 1];
+            const size_t stop = std::min(rowEnd, OutBegin[u] + (last - OutPrefix[u]));
+            size_t i = OutBegin[u] + (e - OutPrefix[u]);
+            if (static_cast<int>(u) >= FirstHub) {
+                // Every out-neighbor of a hub is a hub.
+                for (; i < stop; ++i, ++e) {
+                    count += AndPopCountAbove(HubRow(static_cast<int>(u)), HubRow(Neighbors[i]), Neighbors[i]);
+                }
+                continue;
+            }
+            // u's out-neighbors as marks, so array rows of v are probed instead of merged.
+            for (size_t j = OutBegin[u]; j < rowEnd; ++j) {
+                marks.SetBit(Neighbors[j]);
+            }
+            for (; i < stop; ++i, ++e) {
+                const int v = Neighbors[i];
+                const size_t uv = static_cast<size_t>(v);
+                if (v >= FirstHub) {
+                    // u's neighbors ranked above v follow v in u's sorted row.
+                    count += ProbeCount(Neighbors.data() + i + 1, Neighbors.data() + rowEnd, HubRow(v));
+                }
+                else {
+                    count += ProbeCount(Neighbors.data() + OutBegin[uv], Neighbors.data() + Offsets[uv + 1], marks);
+                }
+            }
+            for (size_t j = OutBegin[u]; j < rowEnd; ++j) {
+                marks.ClearBit(Neighbors[j]);
+            }
+        }
+        return count;
+    }
+
+    // Popcount of a & b restricted to bits above `above`.
+    static size_t AndPopCountAbove(const DynamicBitMask<>& a, const DynamicBitMask<>& b, const int above)
+    {
+        const size_t from = static_cast<size_t>(above) + 1;
+        const size_t word = from / WordBits;
+        if (word >= a.Words.size()) {
+            return 0;
+        }
+        const uint64_t head = a.Words[word] & b.Words[word] & (~uint64_t(0) << (from % WordBits));
+        return static_cast<size_t>(std::popcount(head))
+            + AndPopCountWords(a.Words.data() + word + 1, b.Words.data() + word + 1, a.Words.size() - word - 1);
+    }
+
+    // Number of elements of [first, last) whose bit is set in row.
+    static size_t ProbeCount(const int* first, const int* const last, const DynamicBitMask<>& row)
+    {
+        size_t count = 0;
+        for (; first != last; ++first) {
+            count += (row.Words[static_cast<size_t>(*first) / WordBits] >> (static_cast<size_t>(*first) % WordBits)) & 1;
+        }
+        return count;
+    }
+
+    // Size of the intersection of two sorted ranges.
+    static size_t MergeCount(const int* a, const int* const aEnd, const int* b, const int* const bEnd)
+    {
+        size_t count = 0;
+        while (a != aEnd && b != bEnd) {
+            if (*a < *b) {
+                ++a;
+            }
+            else if (*b < *a) {
+                ++b;
+            }
+            else {
+                ++count;
+                ++a;
+                ++b;
+            }
+        }
+        return count;
+    }
+
+    int Vertices;
+    // Rank -> input vertex and input vertex -> rank.
+    std::vector<int> Order;
+    std::vector<int> Rank;
+    // Sorted neighbor ranks of each rank; out-neighbors of r start at OutBegin[r].
+    std::vector<size_t> Offsets;
+    std::vector<int> Neighbors;
+    std::vector<size_t> OutBegin;
+    // Oriented edges leaving ranks below r.
+    std::vector<size_t> OutPrefix;
+    int FirstHub = 0;
+    // Full neighborhoods of ranks FirstHub and up, as masks over ranks.
+    std::vector<DynamicBitMask<>> HubRows;
+};
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "DynamicBitMask.h"
+#include "Parallel.h"
+#include "RankSelect.h"
+#include "WordKernels.h"
+
+/*
+WaveletMatrix indexes a sequence of unsigned integers for rank, select and range queries.
+
+-Level l holds bit (Bits - 1 - l) of every value, in the order left by stably partitioning the
+ previous level by its bit: zeros first, then ones. Each level is a DynamicBitMask with a
+ RankSelectBits directory, and Zeros[l] counts its clear bits.
+-Access, Rank, Select, Quantile and RangeFrequency each walk the Bits levels once, with one or two
+ rank (or select) queries per level: O(log sigma) for values below 2^Bits.
+-Space is n * Bits bits plus the rank / select directories (about 1/8 more).
+-Construction is level by level: each level's bits are extracted and its values partitioned in
+ parallel (workers own whole words; per-chunk zero counts give every chunk its output offsets), and
+ the rank / select directories of all levels are then built in parallel.
+-Sequences are limited to INT_MAX values, the width of a DynamicBitMask.
+*/
+
+
+// Wavelet matrix over a sequence of unsigned integers.
+template <typename Value = uint32_t>
+struct WaveletMatrix {
+    static_assert(std::is_unsigned_v<Value>, "WaveletMatrix values must be unsigned integers");
+
+    static constexpr size_t NoPosition = static_cast<size_t>(-1);
+    // Minimum number of words a worker handles per level before construction goes parallel.
+    static constexpr size_t BuildWordsPerChunk = size_t(1) << 12;
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor creates an empty sequence.
+    WaveletMatrix() : WaveletMatrix(std::vector<Value>()) {}
+
+    // Index values.
+    explicit WaveletMatrix(std::vector<Value> values) : Length(values.size())
+    {
+        if (values.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+            throw std::length_error("WaveletMatrix sequences are limited to INT_MAX values");
+        }
+        const Value maxValue = values.empty() ? Value(0) : *std::max_element(values.begin(), values.end());
+        Bits = std::max(1, static_cast<int>(std::bit_width(maxValue)));
+
+        const size_t wordCount = WordsFor(Length);
+        const unsigned chunks = ChunksFor(wordCount, BuildWordsPerChunk);
+        std::vector<DynamicBitMask<>> levelBits(static_cast<size_t>(Bits), DynamicBitMask<>(static_cast<int>(Length)));
+        std::vector<Value> next(Length);
+        std::vector<size_t> chunkZeros(chunks);
+        Zeros.resize(static_cast<size_t>(Bits));
+        for (int level = 0; level < Bits; ++level) {
+            const int shift = Bits - 1 - level;
+            uint64_t* words = levelBits[static_cast<size_t>(level)].Words.data();
+            ParallelChunks(wordCount, chunks, [&](unsigned chunk, size_t begin, size_t end) {
+                size_t zeros = 0;
+                for (size_t w = begin; w < end; ++w) {
+                    const size_t first = w * WordBits;
+                    const size_t last = std::min(first + WordBits, Length);
+                    uint64_t word = 0;
+                    for (size_t i = first; i < last; ++i) {
+                        word |= static_cast<uint64_t>((values[i] >> shift) & 1) << (i - first);
+                    }
+                    words[w] = word;
+                    zeros += (last - first) - static_cast<size_t>(std::popcount(word));
+                }
+                chunkZeros[chunk] = zeros;
+            });
+
+            // Output offsets: a chunk's zeros follow earlier chunks' zeros, its ones follow all zeros
+            // and earlier chunks' ones.
+            size_t totalZeros = 0;
+            for (const size_t zeros : chunkZeros) {
+                totalZeros += zeros;
+            }
+            Zeros[static_cast<size_t>(level)] = totalZeros;
+            if (level + 1 == Bits) {
+                break;
+            }
+            ParallelChunks(wordCount, chunks, [&](unsigned chunk, size_t begin, size_t end) {
+                size_t zeroOut = 0;
+                size_t elementsBefore = begin * WordBits;
+                for (unsigned c = 0; c < chunk; ++c) {
+                    zeroOut += chunkZeros[c];
+                }
+                size_t oneOut = totalZeros + elementsBefore - zeroOut;
+                // Branch free: random bits would mispredict half the time.
+                for (size_t i = elementsBefore; i < std::min(end * WordBits, Length); ++i) {
+                    const size_t one = (words[i / WordBits] >> (i % WordBits)) & 1;
+                    next[one != 0 ? oneOut : zeroOut] = values[i];
+                    oneOut += one;
+                    zeroOut += one ^ 1;
+                }
+            });
+            values.swap(next);
+        }
+
+        Levels.resize(static_cast<size_t>(Bits));
+        ParallelChunks(Levels.size(), WorkerCount(), [&](unsigned, size_t begin, size_t end) {
+            for (size_t level = begin; level < end; ++level) {
+                Levels[level] = RankSelectBits(std::move(levelBits[level]));
+            }
+        });
+    }
+
+
+    // Query and Information:
+
+
+    // Number of values in the sequence.
+    size_t Size() const {
+        return Length;
+    }
+
+    // Number of bit levels: the bit width of the largest value.
+    int BitsPerValue() const {
+        return Bits;
+    }
+
+    // Value at position pos.
+    Value Access(size_t pos) const
+    {
+        Value value = 0;
+        for (int level = 0; level < Bits; ++level) {
+            const RankSelectBits& bits = Levels[static_cast<size_t>(level)];
+            if (bits.IsBitSet(pos)) {
+                value |= Value(1) << (Bits - 1 - level);
+                pos = Zeros[static_cast<size_t>(level)] + bits.Rank1(pos);
+            }
+            else {
+                pos = bits.Rank0(pos);
+            }
+        }
+        return value;
+    }
+
+    // Number of occurrences of value in positions [0, end).
+    size_t Rank(const Value value, const size_t end) const
+    {
+        if (!InAlphabet(value)) {
+            return 0;
+        }
+        size_t begin = 0;
+        size_t stop = end;
+        for (int level = 0; level < Bits; ++level) {
+            Descend(level, BitOf(value, level), begin, stop);
+        }
+        return stop - begin;
+    }
+
+    // Position of the occurrence of value with k occurrences before it, or NoPosition.
+    size_t Select(const Value value, const size_t k) const
+    {
+        if (!InAlphabet(value)) {
+            return NoPosition;
+        }
+        // Find value's run on the last level, then map position begin + k back up.
+        size_t begin = 0;
+        size_t stop = Length;
+        for (int level = 0; level < Bits; ++level) {
+            Descend(level, BitOf(value, level), begin, stop);
+        }
+        if (k >= stop - begin) {
+            return NoPosition;
+        }
+        size_t pos = begin + k;
+        for (int level = Bits - 1; level >= 0; --level) {
+            const RankSelectBits& bits = Levels[static_cast<size_t>(level)];
+            pos = BitOf(value, level) ? bits.Select1(pos - Zeros[static_cast<size_t>(level)]) : bits.Select0(pos);
+        }
+        return pos;
+    }
+
+    // The k-th smallest (0-based) value in positions [begin, end); k must be below end - begin.
+    Value Quantile(size_t begin, size_t end, size_t k) const
+    {
+        if (begin >= end || k >= end - begin) {
+            throw std::out_of_range("WaveletMatrix::Quantile rank is outside the range");
+        }
+        Value value = 0;
+        for (int level = 0; level < Bits; ++level) {
+            const RankSelectBits& bits = Levels[static_cast<size_t>(level)];
+            const size_t zeros = bits.Rank0(end) - bits.Rank0(begin);
+            const bool one = k >= zeros;
+            if (one) {
+                k -= zeros;
+                value |= Value(1) << (Bits - 1 - level);
+            }
+            Descend(level, one, begin, end);
+        }
+        return value;
+    }
+
+    // Number of values in [low, high) among positions [begin, end).
+    size_t RangeFrequency(const size_t begin, const size_t end, const Value low, const Value high) const {
+        return low >= high || begin >= end ? 0 : CountLess(begin, end, high) - CountLess(begin, end, low);
+    }
+
+    // Bytes held by the levels and their directories.
+    size_t MemoryBytes() const {
+        size_t bytes = Zeros.size() * sizeof(size_t);
+        for (const RankSelectBits& bits : Levels) {
+            bytes += bits.MemoryBytes();
+        }
+        return bytes;
+    }
+
+private:
+    bool InAlphabet(const Value value) const {
+        return Bits >= std::numeric_limits<Value>::digits || (value >> Bits) == 0;
+    }
+
+    bool BitOf(const Value value, const int level) const {
+        return ((value >> (Bits - 1 - level)) & 1) != 0;
+    }
+
+    // Map [begin, end) on level to the matching range of the values with bit `one` on the next level.
+    void Descend(const int level, const bool one, size_t& begin, size_t& end) const
+    {
+        const RankSelectBits& bits = Levels[static_cast<size_t>(level)];
+        if (one) {
+            begin = Zeros[static_cast<size_t>(level)] + bits.Rank1(begin);
+            end = Zeros[static_cast<size_t>(level)] + bits.Rank1(end);
+        }
+        else {
+            begin = bits.Rank0(begin);
+            end = bits.Rank0(end);
+        }
+    }
+
+    // Number of values below value in positions [begin, end).
+    size_t CountLess(size_t begin, size_t end, const Value value) const
+    {
+        if (!InAlphabet(value)) {
+            return end - begin;
+        }
+        size_t count = 0;
+        for (int level = 0; level < Bits && begin < end; ++level) {
+            const bool one = BitOf(value, level);
+            if (one) {
+                const RankSelectBits& bits = Levels[static_cast<size_t>(level)];
+                count += bits.Rank0(end) - bits.Rank0(begin);
+            }
+            Descend(level, one, begin, end);
+        }
+        return count;
+    }
+
+    size_t Length;
+    int Bits = 1;
+    std::vector<RankSelectBits> Levels;
+    std::vector<size_t> Zeros;
+};
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "Bitmask.h"
+#include "WordKernels.h"
+
+/*
+WideBitMask is the multi-word counterpart of BitMask for universes wider than one integer.
+
+-Same construction, bit manipulation, query and operator set as BitMaskBase, plus AND (&, &=).
+-Bits are stored in uint64_t words; bits at or above TMax are always kept clear.
+-FindFirstSetBit / FindNextSetBit and ForEachSetBit iterate the set bits word by word.
+*/
+
+
+// A fixed width bit mask stored as an array of 64-bit words.
+template <int TMax, typename CheckPolicy = DefaultCheckPolicy>
+struct WideBitMask {
+    static_assert(TMax > 0, "WideBitMask needs at least one bit");
+
+    static constexpr size_t WordCount = WordsFor(static_cast<size_t>(TMax));
+
+    // Run CheckPolicy on bitPos; false means the operation should be skipped.
+    static constexpr bool IsBitInRange(const int bitPos)
+    {
+        return CheckPolicy::Validate(bitPos, TMax);
+    }
+
+
+    // Constructors and Initialization:
+
+
+    // Default constructor initializes every word to zero.
+    constexpr WideBitMask() : Words{} {}
+
+    // Variadic template constructor for setting bits during initialization.
+    template<typename...Args>
+        requires ((std::is_integral_v<Args> || std::is_enum_v<Args>) && ...)
+    constexpr WideBitMask(const Args&...bits) : Words{}
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Build a mask from WordCount raw words; stray bits above TMax are dropped.
+    static WideBitMask FromWords(const uint64_t* words)
+    {
+        WideBitMask result;
+        for (size_t i = 0; i < WordCount; ++i) {
+            result.Words[i] = words[i];
+        }
+        result.TrimTail();
+        return result;
+    }
+
+    // Reset all bits to zero.
+    void ResetAllBits() {
+        Words.fill(0);
+    }
+
+
+    // Bit Manipulation Functions:
+
+
+    // Set a specific bit at position bitPos.
+    constexpr void SetBit(const int bitPos)
+    {
+        if (IsBitInRange(bitPos)) {
+            Words[bitPos / WordBits] |= uint64_t(1) << (bitPos % WordBits);
+        }
+    }
+
+    // Set multiple bits.
+    template<typename...Args>
+    void SetBits(const Args&... bits)
+    {
+        (SetBit(static_cast<int>(bits)), ...);
+    }
+
+    // Clear a specific bit at position bitPos.
+    void ClearBit(const int bitPos)
+    {
+        if (IsBitInRange(bitPos)) {
+            Words[bitPos / WordBits] &= ~(uint64_t(1) << (bitPos % WordBits));
+        }
+    }
+
+    // Clear multiple bits.
+    template<typename...Args>
+    void ClearBits(const Args&... bits)
+    {
+        (ClearBit(static_cast<int>(bits)), ...);
+    }
+
+    // Toggle a specific bit at position bitPos.
+    void ToggleBit(const int bitPos)
+    {
+        if (IsBitInRange(bitPos)) {
+            Words[bitPos / WordBits] ^= uint64_t(1) << (bitPos % WordBits);
+        }
+    }
+
+    // Toggle multiple bits.
+    template<typename...Args>
+    void ToggleBits(const Args&... bits)
+    {
+        (ToggleBit(static_cast<int>(bits)), ...);
+    }
+
+
+    // Query and Information:
+
+
+    // Check if a specific bit at position pos is set.
+    bool IsBitSet(const int pos) const {
+        return IsBitInRange(pos) && ((Words[pos / WordBits] >> (pos % WordBits)) & 1) != 0;
+    }
+
+    // Check if any bit is set.
+    bool AnyBitSet() const {
+        return AnyWords(Words.data(), WordCount);
+    }
+
+    // Check if any bit in this mask is also set in otherMask.
+    bool IsAnyBitSetInRange(const WideBitMask& otherMask) const {
+        return IntersectsWords(Words.data(), otherMask.Words.data(), WordCount);
+    }
+
+    // Check if all TMax bits are set.
+    bool AllBitsSet() const {
+        return CountSetBits() == TMax;
+    }
+
+    // Count the number of set bits.
+    int CountSetBits() const {
+        return static_cast<int>(PopCountWords(Words.data(), WordCount));
+    }
+
+    // Count the bits set in both masks without building the intersection.
+    int CountSetBitsAnd(const WideBitMask& other) const {
+        return static_cast<int>(AndPopCountWords(Words.data(), other.Words.data(), WordCount));
+    }
+
+    // Position of the lowest set bit, or TMax when the mask is empty.
+    int FindFirstSetBit() const {
+        return FindNextSetBit(0);
+    }
+
+    // Position of the first set bit at or after pos, or TMax when there is none.
+    int FindNextSetBit(const int pos) const {
+        if (pos >= TMax) {
+            return TMax;
+        }
+        const size_t next = FindNextSetWords(Words.data(), WordCount, static_cast<size_t>(pos < 0 ? 0 : pos));
+        return next < static_cast<size_t>(TMax) ? static_cast<int>(next) : TMax;
+    }
+
+    // Call func(pos) for every set bit in increasing order.
+    template <typename Func>
+    void ForEachSetBit(Func&& func) const {
+        for (size_t i = 0; i < WordCount; ++i) {
+            uint64_t word = Words[i];
+            while (word != 0) {
+                func(static_cast<int>(i * WordBits + std::countr_zero(word)));
+                word &= word - 1;
+            }
+        }
+    }
+
+    // Convert the mask to a binary string, highest bit first.
+    std::string toBinaryString() const {
+        std::string result;
+        result.reserve(TMax);
+        for (int i = TMax - 1; i >= 0; i--) {
+            result += IsBitSet(i) ? '1' : '0';
+        }
+        return result;
+    }
+
+
+    // Bitwise Operations:
+
+
+    WideBitMask operator+(const WideBitMask& other) const {
+        WideBitMask result(*this);
+        return result += other;
+    }
+
+    WideBitMask operator-(const WideBitMask& other) const {
+        WideBitMask result(*this);
+        return result -= other;
+    }
+
+    WideBitMask operator&(const WideBitMask& other) const {
+        WideBitMask result(*this);
+        return result &= other;
+    }
+
+    WideBitMask operator^(const WideBitMask& other) const {
+        WideBitMask result(*this);
+        return result ^= other;
+    }
+
+    WideBitMask& operator+=(const WideBitMask& other) {
+        OrWords(Words.data(), other.Words.data(), WordCount);
+        return *this;
+    }
+
+    WideBitMask& operator-=(const WideBitMask& other) {
+        AndNotWords(Words.data(), other.Words.data(), WordCount);
+        return *this;
+    }
+
+    WideBitMask& operator&=(const WideBitMask& other) {
+        AndWords(Words.data(), other.Words.data(), WordCount);
+        return *this;
+    }
+
+    WideBitMask& operator^=(const WideBitMask& other) {
+        XorWords(Words.data(), other.Words.data(), WordCount);
+        return *this;
+    }
+
+    WideBitMask operator~() const {
+        WideBitMask result(*this);
+        NotWords(result.Words.data(), WordCount);
+        result.TrimTail();
+        return result;
+    }
+
+    WideBitMask operator<<(int shift) const {
+        WideBitMask result(*this);
+        return result <<= shift;
+    }
+
+    WideBitMask operator>>(int shift) const {
+        WideBitMask result(*this);
+        return result >>= shift;
+    }
+
+    WideBitMask& operator<<=(int shift) {
+        ShiftLeftWords(Words.data(), WordCount, static_cast<size_t>(shift));
+        TrimTail();
+        return *this;
+    }
+
+    WideBitMask& operator>>=(int shift) {
+        ShiftRightWords(Words.data(), WordCount, static_cast<size_t>(shift));
+        return *this;
+    }
+
+    bool operator==(const WideBitMask& other) const {
+        return EqualWords(Words.data(), other.Words.data(), WordCount);
+    }
+
+    bool operator!=(const WideBitMask& other) const {
+        return !(*this == other);
+    }
+
+    // Clear the unused bits above TMax in the last word.
+    void TrimTail() {
+        Words[WordCount - 1] &= LastWordMask(static_cast<size_t>(TMax));
+    }
+
+    std::array<uint64_t, WordCount> Words;
+};
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/*
+Word kernels shared by the multi-word masks.
+
+Every kernel works on a run of uint64_t words, with bit i stored in word i / 64 at bit i % 64.
+They are plain loops over the words so the compiler can unroll and vectorize them, and the
+multi-word masks build their operators on top of them instead of repeating the loops.
+*/
+
+
+// Bits per storage word.
+constexpr size_t WordBits = 64;
+
+// Number of words needed to hold `bits` bits.
+constexpr size_t WordsFor(const size_t bits)
+{
+    return (bits + WordBits - 1) / WordBits;
+}
+
+// Mask of the valid bits in the last word of a `bits` wide mask.
+constexpr uint64_t LastWordMask(const size_t bits)
+{
+    return bits % WordBits == 0 ? ~uint64_t(0) : (uint64_t(1) << (bits % WordBits)) - 1;
+}
+
+
+// Queries:
+
+
+// Count the set bits in count words.
+inline size_t PopCountWords(const uint64_t* words, const size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += static_cast<size_t>(std::popcount(words[i]));
+    }
+    return total;
+}
+
+// Count the set bits of a & b without materializing the intersection.
+inline size_t AndPopCountWords(const uint64_t* a, const uint64_t* b, const size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += static_cast<size_t>(std::popcount(a[i] & b[i]));
+    }
+    return total;
+}
+
+// Count the set bits of the AND of N word runs in one pass, without materializing the intersection.
+template <size_t N>
+size_t AndPopCountWordsN(const uint64_t* const (&operands)[N], const size_t count)
+{
+    static_assert(N > 0, "AndPopCountWordsN needs at least one operand");
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t word = operands[0][i];
+        for (size_t k = 1; k < N; ++k) {
+            word &= operands[k][i];
+        }
+        total += static_cast<size_t>(std::popcount(word));
+    }
+    return total;
+}
+
+// Check if any bit is set in count words.
+inline bool AnyWords(const uint64_t* words, const size_t count)
+{
+    uint64_t any = 0;
+    for (size_t i = 0; i < count; ++i) {
+        any |= words[i];
+    }
+    return any != 0;
+}
+
+// Check if a and b share any set bit.
+inline bool IntersectsWords(const uint64_t* a, const uint64_t* b, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if ((a[i] & b[i]) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check two word runs for equality.
+inline bool EqualWords(const uint64_t* a, const uint64_t* b, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Position of the first set bit at or after `from`, or count * 64 when there is none.
+inline size_t FindNextSetWords(const uint64_t* words, const size_t count, const size_t from)
+{
+    size_t index = from / WordBits;
+    if (index >= count) {
+        return count * WordBits;
+    }
+    uint64_t word = words[index] & (~uint64_t(0) << (from % WordBits));
+    while (word == 0) {
+        if (++index == count) {
+            return count * WordBits;
+        }
+        word = words[index];
+    }
+    return index * WordBits + static_cast<size_t>(std::countr_zero(word));
+}
+
+// Position of the first clear bit at or after `from`, or count * 64 when there is none.
+inline size_t FindNextClearWords(const uint64_t* words, const size_t count, const size_t from)
+{
+    size_t index = from / WordBits;
+    if (index >= count) {
+        return count * WordBits;
+    }
+    uint64_t word = ~words[index] & (~uint64_t(0) << (from % WordBits));
+    while (word == 0) {
+        if (++index == count) {
+            return count * WordBits;
+        }
+        word = ~words[index];
+    }
+    return index * WordBits + static_cast<size_t>(std::countr_zero(word));
+}
+
+// Position of the set bit of word with `rank` set bits below it; rank must be below popcount(word).
+// One PDEP with BMI2; otherwise whole bytes are skipped by popcount before the last byte is scanned.
+inline int SelectInWord(const uint64_t word, unsigned rank)
+{
+#if defined(__BMI2__)
+    return std::countr_zero(_pdep_u64(uint64_t(1) << rank, word));
+#else
+    int shift = 0;
+    for (unsigned count; rank >= (count = static_cast<unsigned>(std::popcount((word >> shift) & 0xFF))); shift += 8) {
+        rank -= count;
+    }
+    uint64_t byte = (word >> shift) & 0xFF;
+    for (; rank != 0; --rank) {
+        byte &= byte - 1;
+    }
+    return shift + std::countr_zero(byte);
+#endif
+}
+
+
+// Transpose a 64 x 64 bit matrix in place: bit c of block[r] moves to bit r of block[c].
+// Swaps ever smaller off-diagonal quadrants, 6 rounds of 32 word pairs instead of 4096 bit moves.
+inline void TransposeWords64(uint64_t* block)
+{
+    uint64_t mask = 0x00000000FFFFFFFFull;
+    for (unsigned width = 32; width != 0; width >>= 1, mask ^= mask << width) {
+        for (unsigned row = 0; row < 64; row = ((row | width) + 1) & ~width) {
+            const uint64_t swap = ((block[row] >> width) ^ block[row | width]) & mask;
+            block[row] ^= swap << width;
+            block[row | width] ^= swap;
+        }
+    }
+}
+
+
+// In-place Bitwise Operations (dst op= src):
+
+
+inline void OrWords(uint64_t* dst, const uint64_t* src, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] |= src[i];
+    }
+}
+
+inline void AndWords(uint64_t* dst, const uint64_t* src, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] &= src[i];
+    }
+}
+
+inline void AndNotWords(uint64_t* dst, const uint64_t* src, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] &= ~src[i];
+    }
+}
+
+inline void XorWords(uint64_t* dst, const uint64_t* src, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+inline void NotWords(uint64_t* dst, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = ~dst[i];
+    }
+}
+
+
+// In-place Bitwise Operations that also return the popcount of the result, in the same pass:
+
+
+inline size_t OrWordsPopCount(uint64_t* dst, const uint64_t* src, const size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] |= src[i];
+        total += static_cast<size_t>(std::popcount(dst[i]));
+    }
+    return total;
+}
+
+inline size_t AndWordsPopCount(uint64_t* dst, const uint64_t* src, const size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] &= src[i];
+        total += static_cast<size_t>(std::popcount(dst[i]));
+    }
+    return total;
+}
+
+inline size_t AndNotWordsPopCount(uint64_t* dst, const uint64_t* src, const size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] &= ~src[i];
+        total += static_cast<size_t>(std::popcount(dst[i]));
+    }
+    return total;
+}
+
+inline size_t XorWordsPopCount(uint64_t* dst, const uint64_t* src, const size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] ^= src[i];
+        total += static_cast<size_t>(std::popcount(dst[i]));
+    }
+    return total;
+}
+
+
+// Fused Operations:
+
+
+// Dataflow transfer dst = gen | (in & ~kill) in one pass. Returns whether any word of dst changed, from
+// the OR of the old ^ new words, so convergence needs no separate compare pass.
+inline bool TransferWords(uint64_t* dst, const uint64_t* gen, const uint64_t* in, const uint64_t* kill, const size_t count)
+{
+    uint64_t changed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t value = gen[i] | (in[i] & ~kill[i]);
+        changed |= value ^ dst[i];
+        dst[i] = value;
+    }
+    return changed != 0;
+}
+
+
+// Shifts (towards higher positions for left, lower positions for right), carrying across words:
+
+
+inline void ShiftLeftWords(uint64_t* words, const size_t count, const size_t shift)
+{
+    const size_t wordShift = shift / WordBits;
+    const unsigned bitShift = static_cast<unsigned>(shift % WordBits);
+    if (wordShift >= count) {
+        for (size_t i = 0; i < count; ++i) {
+            words[i] = 0;
+        }
+        return;
+    }
+    for (size_t i = count; i-- > wordShift;) {
+        const size_t src = i - wordShift;
+        uint64_t value = words[src] << bitShift;
+        if (bitShift != 0 && src > 0) {
+            value |= words[src - 1] >> (WordBits - bitShift);
+        }
+        words[i] = value;
+    }
+    for (size_t i = 0; i < wordShift; ++i) {
+        words[i] = 0;
+    }
+}
+
+inline void ShiftRightWords(uint64_t* words, const size_t count, const size_t shift)
+{
+    const size_t wordShift = shift / WordBits;
+    const unsigned bitShift = static_cast<unsigned>(shift % WordBits);
+    if (wordShift >= count) {
+        for (size_t i = 0; i < count; ++i) {
+            words[i] = 0;
+        }
+        return;
+    }
+    for (size_t i = 0; i + wordShift < count; ++i) {
+        const size_t src = i + wordShift;
+        uint64_t value = words[src] >> bitShift;
+        if (bitShift != 0 && src + 1 < count) {
+            value |= words[src + 1] << (WordBits - bitShift);
+        }
+        words[i] = value;
+    }
+    for (size_t i = count - wordShift; i < count; ++i) {
+        words[i] = 0;
+    }
+}